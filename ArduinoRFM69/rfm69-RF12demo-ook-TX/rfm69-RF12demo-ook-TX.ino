@@ -299,88 +299,27 @@ static void sendook(uint8_t header, const void* ptr, int len) {
   setMode(MODE_STANDBY);
 }
 
-//Packet mode OOK transmit buffer
-uint8_t ookBuf[66];
-uint8_t k = 0;
-uint8_t l = 0;
-
-//Packet mode OOK add one packet-bit to transmit buffer
-void addOutBit(uint8_t v) {
-  if (k <= 65) {
-    ookBuf[k] |= (v & 1) << (7 - l);
-    if (++l == 8) {
-      l = 0;
-      k++;
-      if (k > 65) {
-        Serial.println("FIFO size exceeded. Partial transmission");
-      } else {
-        ookBuf[k] = 0;
-      }
-    }
-  }
-}
-
-//Packet mode OOK send complete packet
-void sendPacket() {
-  //pad ookBuf with OFF (=0) to fill last byte.
-  while (l)
-    addOutBit(0);
-  //      for (uint8_t i = 0; i < k; ++i)
-  //          printf("%02x", ookBuf[i]);
-  //      printf("\n");
-  sendook(0, ookBuf, k);
-}
-
-static void fs20sendBits(uint16_t data, uint8_t bits) {
-  if (bits == 8) {
-    ++bits;
-    data = (data << 1) | parity_even_bit(data);
-  }
-  for (uint16_t mask = 1 << (bits - 1); mask != 0; mask >>= 1) {
-    uint8_t n = (data & mask ? 3 : 2);
-    for (uint8_t on = n; on > 0; on--)
-      addOutBit(1);
-    for (uint8_t off = n; off > 0; off--)
-      addOutBit(0);
-  }
-}
+//Packet mode OOK waveform image of the last command sent
+#define OOK_IMAGE_CACHE 1 // RAM is tight, keep only the last one
+#include "ookimage.h"
+static OokImageCache ookCache;
 
-void startOOK(uint32_t br) {
-  //clear the ookBuf
-  k = 0;
-  l = 0;
-  ookBuf[0] = 0;
+//Packet mode OOK send an image, with a pause of 'gap' ms after each
+static void sendImage(const OokImage& img, uint32_t br, byte repeats, byte gap) {
   setBitrate(br);
-}
-
-void stopOOK() {
-  sendPacket();
+  for (byte i = 0; i < repeats; ++i) {
+    sendook(0, img.data, img.len);
+    delay(gap); // approximate
+  }
 }
 
 static void kakuSend(char addr, byte device, byte on) {
-  int cmd = 0x600 | ((device - 1) << 4) | ((addr - 1) & 0xF);
-  if (on)
-    cmd |= 0x800;
-  for (byte i = 0; i < 4; ++i) {
-    startOOK(2667); //PACKET mode: 375us (2667bps) largest common divisor
-    int sr = cmd;
-    for (uint8_t bit = 0; bit < 12; ++bit) {
-      addOutBit(1);
-      addOutBit(0);
-      addOutBit(0);
-      addOutBit(0);
-      uint8_t n = (sr & 1 ? 3 : 1);
-      for (uint8_t on = n; on > 0; on--)
-        addOutBit(1);
-      for (uint8_t off = 4 - n; off > 0; off--)
-        addOutBit(0);
-      sr >>= 1;
-    }
-    addOutBit(1);
-    addOutBit(0);
-    stopOOK();
-    delay(11); // approximate
-  }
+  bool hit;
+  OokImage& img = ookCache.lookup(OokImageCache::KAKU,
+                                  (uint32_t) addr << 16 | device << 8 | on, hit);
+  if (!hit)
+    ookKaku(img, addr, device, on);
+  sendImage(img, 2667, 4, 11); //PACKET mode: 375us (2667bps) largest common divisor
 }
 
 #else
@@ -451,11 +390,18 @@ static void ook_deinitialize() {
 }
 
 static void fs20cmd(word house, byte addr, byte cmd) {
+#if RF69_COMPAT
+  bool hit;
+  OokImage& img = ookCache.lookup(OokImageCache::FS20,
+                                  (uint32_t) house << 16 | addr << 8 | cmd, hit);
+  if (!hit && !ookFS20(img, house, addr, cmd)) {
+    Serial.println("FIFO size exceeded. Partial transmission");
+    ookCache.drop(img);
+  }
+  sendImage(img, 5000, 3, 10); //PACKET mode: 200us (5000bps) largest common divisor
+#else
   byte sum = 6 + (house >> 8) + house + addr + cmd;
   for (byte i = 0; i < 3; ++i) {
-#if RF69_COMPAT
-    startOOK(5000);
-#endif
     fs20sendBits(1, 13);
     fs20sendBits(house >> 8, 8);
     fs20sendBits(house, 8);
@@ -463,11 +409,9 @@ static void fs20cmd(word house, byte addr, byte cmd) {
     fs20sendBits(cmd, 8);
     fs20sendBits(sum, 8);
     fs20sendBits(0, 1);
-#if RF69_COMPAT
-    stopOOK();
-#endif
     delay(10);
   }
+#endif
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
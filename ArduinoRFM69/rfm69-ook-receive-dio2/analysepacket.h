@@ -16,83 +16,72 @@
 \*********************************************************************************************/
 #define RKR_PRINT_HEX
 
-void analysepacket(byte mode)
+/*
+ * psEstimateShortLong
+ *
+ * Determine the short and long timing of the pulses (shift 4) or spaces (shift 0)
+ * in one pass over psiNibbles: build a histogram per timing index and take the
+ * two most frequent ones. Gaps and glitches occur at most once per package, so
+ * they do not make it to the top 2. A runner-up below 1/8 of the winner is not
+ * data, then there is a single timing and Long = Short.
+ */
+static void psEstimateShortLong(byte shift, uint &Short, uint &Long)
 {
-		uint psniStart = 0;
-		byte psniSize = psiNibbles[psniStart];
+	uint hist[PS_MICRO_ELEMENTS];
+
+	for (byte i = 0; i < PS_MICRO_ELEMENTS; i++) {
+		hist[i] = 0;
+	}
+	// first pair can be partial noise, skip it
+	for (uint x = 1; x < psiCount; x++) {
+		byte ix = (psiNibbles[x] >> shift) & 0x0F;
+		if (ix < psMinMaxCount) {
+			hist[ix]++;
+		}
+	}
+	byte first = PSI_OVERFLOW;
+	byte second = PSI_OVERFLOW;
+	for (byte i = 0; i < psMinMaxCount; i++) {
+		if ((first == PSI_OVERFLOW) || (hist[i] > hist[first])) {
+			second = first;
+			first = i;
+		}
+		else if ((second == PSI_OVERFLOW) || (hist[i] > hist[second])) {
+			second = i;
+		}
+	}
+	Short = Long = 0;
+	if ((first == PSI_OVERFLOW) || (hist[first] == 0)) {
+		return;
+	}
+	Short = Long = (psMicroMin[first] + psMicroMax[first]) / 2;
+	if ((second != PSI_OVERFLOW) && (hist[second] > 0) && (hist[second] >= hist[first] / 8)) {
+		uint y = (psMicroMin[second] + psMicroMax[second]) / 2;
+		if (y < Short) {
+			Short = y;
+		}
+		else {
+			Long = y;
+		}
+	}
+}
 
+void analysepacket(byte mode)
+{
       Serial.print(F("AnalysePacket"));
       Serial.print(F(", Pulses:"));
-      Serial.print(psniSize*2);
+      Serial.print(psiCount*2);
       Serial.print(F(", "));
 
-      int x;
-      unsigned int y,z;
+      uint x;
+      unsigned int y;
 
-      unsigned int MarkShort=50000;
-      unsigned int MarkLong=0;
-      for(x=2;x<psniSize;x++)
-        {
-		byte pulse = ((psiNibbles[psniStart + x] >> 4) & 0x0F);
-		y = (psMicroMax[pulse] + psMicroMin[pulse]) / 2;
-        if(y<MarkShort)
-          MarkShort=y;
-        if(y>MarkLong)
-          MarkLong=y;
-        }
-      z=true;
-      while(z)
-        {
-        z=false;
-      for(x=2;x<psniSize;x++)
-        {
-		byte pulse = ((psiNibbles[psniStart + x] >> 4) & 0x0F);
-		y = (psMicroMax[pulse] + psMicroMin[pulse]) / 2;
-          if(y>MarkShort && y<(MarkShort+MarkShort/2))
-            {
-            MarkShort=y;
-            z=true;
-            }
-          if(y<MarkLong && y>(MarkLong-MarkLong/2))
-            {
-            MarkLong=y;
-            z=true;
-            }
-          }
-        }
+      unsigned int MarkShort, MarkLong;
+      psEstimateShortLong(4, MarkShort, MarkLong);
       unsigned int MarkMid=((MarkLong-MarkShort)/2)+MarkShort;
 
-      unsigned int SpaceShort=50000;
-      unsigned int SpaceLong=0;
-      for(x=2;x<psniSize;x++)
-        {
-		byte space = ((psiNibbles[psniStart + x]) & 0x0F);
-		y = (psMicroMax[space] + psMicroMin[space]) / 2;
-        if(y<SpaceShort)
-          SpaceShort=y;
-        if(y>SpaceLong)
-          SpaceLong=y;
-        }
-      z=true;
-      while(z)
-        {
-        z=false;
-      for(x=2;x<psniSize;x++)
-        {
-		byte space = ((psiNibbles[psniStart + x]) & 0x0F);
-		y = (psMicroMax[space] + psMicroMin[space]) / 2;
-          if(y>SpaceShort && y<(SpaceShort+SpaceShort/2))
-            {
-            SpaceShort=y;
-            z=true;
-            }
-          if(y<SpaceLong && y>(SpaceLong-SpaceLong/2))
-            {
-            SpaceLong=y;
-            z=true;
-            }
-          }
-        }
+      unsigned int SpaceShort, SpaceLong;
+      psEstimateShortLong(0, SpaceShort, SpaceLong);
       int SpaceMid=((SpaceLong-SpaceShort)/2)+SpaceShort;
 
       // Bepaal soort signaal
@@ -108,9 +97,9 @@ void analysepacket(byte mode)
       if(y==0)Serial.print(F("?"));
       if(y==1)
         {
-      for(x=1;x<psniSize;x++)
+      for(x=1;x<psiCount;x++)
         {
-		byte pulse = ((psiNibbles[psniStart + x] >> 4) & 0x0F);
+		byte pulse = ((psiNibbles[x] >> 4) & 0x0F);
 		y = (psMicroMax[pulse] + psMicroMin[pulse]) / 2;
 #ifndef RKR_PRINT_HEX
           if(y>MarkMid)
@@ -135,9 +124,9 @@ void analysepacket(byte mode)
         }
       if(y==2)
         {
-      for(x=1;x<psniSize;x++)
+      for(x=1;x<psiCount;x++)
         {
-		byte space = ((psiNibbles[psniStart + x]) & 0x0F);
+		byte space = ((psiNibbles[x]) & 0x0F);
 		y = (psMicroMax[space] + psMicroMin[space]) / 2;
 #ifndef RKR_PRINT_HEX
           if(y>SpaceMid)
@@ -162,9 +151,9 @@ void analysepacket(byte mode)
         }
       if(y==3)
         {
-      for(x=1;x<psniSize;x++)
+      for(x=1;x<psiCount;x++)
         {
-		byte pulse = ((psiNibbles[psniStart + x] >> 4) & 0x0F);
+		byte pulse = ((psiNibbles[x] >> 4) & 0x0F);
 		y = (psMicroMax[pulse] + psMicroMin[pulse]) / 2;
 #ifndef RKR_PRINT_HEX
           if(y>MarkMid)
@@ -180,7 +169,7 @@ void analysepacket(byte mode)
 			hex = 0;
 		}
 #endif
-		byte space = ((psiNibbles[psniStart + x]) & 0x0F);
+		byte space = ((psiNibbles[x]) & 0x0F);
 		y = (psMicroMax[space] + psMicroMin[space]) / 2;
 #ifndef RKR_PRINT_HEX
           if(y>SpaceMid)
@@ -244,6 +244,87 @@ static void psiSortMergeMicroMinMax() {
 	}
 }
 
+/*
+ * psiConsensus
+ *
+ * Majority vote the repeated packages recorded in jDataStart/jDataEnd.
+ * Packages are aligned on their end gap, as the start may be garbled while
+ * the AGC settles. Each element is clipped to Short (0), Long (1) or gap (2)
+ * before voting, so a single corrupted element in one repeat is outvoted
+ * by the others. Needs 3 or more repeats to correct anything.
+ * When no decoder reported the capture, the voted package is replayed
+ * through the decoders, framed by its gap.
+ */
+static byte psiVote(byte nPackages, uint d, const uint *psiDataShort, const uint *psiDataLong,
+		const uint *psiCountData, bool &fAgree) {
+	byte votes[3] = {0, 0, 0};
+	for (byte p = 0; p < nPackages; p++) {
+		if (jDataEnd[p] < jDataStart[p] + d) {
+			continue; // shorter package
+		}
+		uint jj = jDataEnd[p] - d;
+		uint ix = (jj & 1) ? psixSpace : psixPulse;
+		byte ps = psiNibblePS(psiNibbles, jj);
+		votes[(ps > psiDataLong[ix]) ? 2 : (((psiCountData[ix] <= 2) && (ps <= psiDataShort[ix])) ? 0 : 1)]++;
+	}
+	byte v = (votes[1] > votes[0]) ? 1 : 0;
+	if (votes[2] > votes[v]) {
+		v = 2;
+	}
+	fAgree = (votes[v] == votes[0] + votes[1] + votes[2]);
+	return v;
+}
+
+static void psiReplay(uint width, uint8_t signal) {
+	for (uint8_t i = 0; decoders[i]; i++) {
+		if (decoders[i]->nextPulse(width, signal))
+			decoders[i]->decoded(decoders[i]);
+	}
+}
+
+static void psiConsensus(byte nPackages, const uint *psiDataShort, const uint *psiDataLong,
+		const uint *psiCountData) {
+	uint len = 0;
+	for (byte p = 0; p < nPackages; p++) {
+		uint l = jDataEnd[p] - jDataStart[p] + 1;
+		if (l > len) {
+			len = l;
+		}
+	}
+	// 1 print voted package and number of corrected elements
+	uint nFixed = 0;
+	Serial.println();
+	PrintNum(nPackages, 'V', 1);
+	PrintChar(' ');
+	for (uint d = len; d-- > 0;) {
+		bool fAgree;
+		byte v = psiVote(nPackages, d, psiDataShort, psiDataLong, psiCountData, fAgree);
+		if (!fAgree) {
+			nFixed++;
+		}
+		PrintChar('0' + v);
+	}
+	PrintNum(nFixed, '!', 1);
+	if (fOOKDecoded || (nPackages < 3) || (nFixed == 0)) {
+		return; // decoders did fine on their own, or there is nothing to add
+	}
+	// 2 replay it: gap, package, end of transmission
+	Serial.println();
+	uint jLast = jDataEnd[nPackages - 1];
+	uint ixGap = (jLast & 1) ? psixSpace : psixPulse;
+	byte psGap = psiNibblePS(psiNibbles, jLast);
+	uint gap = (psMicroMin[psGap] + psMicroMax[psGap]) / 2;
+	psiReplay(gap, ((jLast - len) & 1) == 0);
+	for (uint d = len; d-- > 0;) {
+		bool fAgree;
+		byte v = psiVote(nPackages, d, psiDataShort, psiDataLong, psiCountData, fAgree);
+		uint ix = ((jLast - d) & 1) ? psixSpace : psixPulse;
+		byte ps = (v == 2) ? psGap : ((v == 0) ? psiDataShort[ix] : psiDataLong[ix]);
+		psiReplay((psMicroMin[ps] + psMicroMax[ps]) / 2, ix == psixPulse);
+	}
+	psiReplay(1, ixGap != psixPulse);
+}
+
 void psiPrint() {
 	uint psCount;
 	bool fPrintHex = false;
@@ -417,6 +498,7 @@ void psiPrint() {
 	//fPrintHex = 0; // move to JS
 	byte hexData = 0;
 	if (jMaxCount > 1) { //assume repeated packages
+		psiConsensus(jDataCount, psiDataShort, psiDataLong, psiCountData);
 		uint jDataRepeat = 0;
 		uint j = 0;
 		// try all packages, print last match incl surrounding gaps, continue at first non match
@@ -821,6 +903,7 @@ static void processReady() {
 	}
 	psCount = 0;
 	psInit();
+	fOOKDecoded = false;
 }
 
 /*
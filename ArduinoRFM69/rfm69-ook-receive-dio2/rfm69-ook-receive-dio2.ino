@@ -30,6 +30,7 @@ const uint8_t max_decoders = 6; //Too many decoders slows processing down.
 DecodeOOK* decoders[max_decoders] = {NULL};
 uint8_t di = 0;
 void printOOK (class DecodeOOK* decoder);
+bool fOOKDecoded = false; // a decoder reported during this capture
 
 #if FREQ_BAND == 433
 //433MHz
@@ -154,6 +155,7 @@ void printOOK (class DecodeOOK* decoder) {
   //rf12_settings_text(textbuf);
   //Serial.print(textbuf);
   //Serial.print(' ');
+  fOOKDecoded = true;
   Serial.print(decoder->tag);
   Serial.print(' ');
   for (uint8_t i = 0; i < pos; ++i) {
@@ -5,9 +5,26 @@
 #define STATLOG 0
 #endif
 
+// configuration registers kept in a context, the others hold status or
+// are not touched by either mode
+static const uint8_t contextRegs[] = {
+  0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, // modulation, freq
+  0x0B,                                           // afc ctrl
+  0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,       // pa, ocp
+  0x18, 0x19, 0x1A, 0x1E,                         // lna, rxbw, afc
+  0x25, 0x26,                                     // dio, clkout
+  0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E,             // rssi, preamble
+  0x2F, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, // sync value
+  0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D,       // packet, fifo
+  0x58, 0x5A, 0x5C, 0x6F, 0x71,                   // test regs
+};
+
 class RF69A {
   public:
     typedef void (*ooktrans_cb)(uint16_t pulse_dur, uint8_t signal, uint8_t rssi);
+    // called while the band is quiet, with the time since the last edge,
+    // returns true if it used the radio and receiving has to pick up again
+    typedef bool (*idle_cb)(uint32_t quiet_us);
     RF69A();
     void init (uint8_t id, uint8_t group, uint32_t freq);
     uint8_t readRSSI();
@@ -20,13 +37,19 @@ class RF69A {
     void DataModule(uint8_t module);
     void OOKthdMode(uint8_t thdmode);
     void exit_receive();
-    void receiveOOK_forever(ooktrans_cb processBit);
+    void enter_receive();
+    void receiveOOK_forever(ooktrans_cb processBit, idle_cb idle = NULL);
     void sendook(uint8_t header, const void* ptr, int len);
     void init_transmit(uint8_t band);
     void exit_transmit();
     void readAllRegs();
     //int readStatus();
 
+    // saved register contexts, to switch between modes without a re-init
+    enum { CONTEXT_SIZE = sizeof contextRegs };
+    void saveContext(uint8_t* ctx);
+    uint8_t switchContext(const uint8_t* from, const uint8_t* to);
+
     uint8_t myGroup;
     uint8_t myId;
 
@@ -231,7 +254,33 @@ void RF69A::exit_receive() {
   writeReg(REG_RSSITHRESH, 0xE4); // RssiThresh 0xE4
 }
 
-void RF69A::receiveOOK_forever(ooktrans_cb processBit) {
+// receive again after switchContext() back to the OOK registers
+void RF69A::enter_receive() {
+  writeReg(REG_AFCFEI, (1 << 1)); //clear AFC
+  setMode(MODE_RECEIVE);
+}
+
+void RF69A::saveContext(uint8_t* ctx) {
+  for (uint8_t i = 0; i < CONTEXT_SIZE; ++i)
+    ctx[i] = readReg(contextRegs[i]);
+}
+
+// go to sleep and write the registers that differ between two saved
+// contexts, returns the number written
+uint8_t RF69A::switchContext(const uint8_t* from, const uint8_t* to) {
+  uint8_t n = 0;
+
+  setMode(MODE_SLEEP);
+  for (uint8_t i = 0; i < CONTEXT_SIZE; ++i) {
+    if (from[i] != to[i]) {
+      writeReg(contextRegs[i], to[i]);
+      ++n;
+    }
+  }
+  return n;
+}
+
+void RF69A::receiveOOK_forever(ooktrans_cb processBit, idle_cb idle) {
   //moving average buffer
   uint8_t avg_len = 5;
   uint32_t filter = 0;
@@ -314,6 +363,11 @@ void RF69A::receiveOOK_forever(ooktrans_cb processBit) {
       //send fake pulse to notify end of transmission to decoders
       processBit(micros() - last_edge, last_data, 0);
       processBit(1, !last_data, 0);
+      if (idle && idle(micros() - last_edge)) {
+        //the radio was away, pick up the polling where it is now
+        last_edge = micros();
+        soon = last_edge;
+      }
     } else
       last_steady_rssi = delayed_rssi;
 
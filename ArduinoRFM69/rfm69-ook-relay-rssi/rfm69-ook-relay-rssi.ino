@@ -14,6 +14,7 @@
 
 #define FREQ_BAND 868 //868 or 433
 #define SERIAL_BAUD 57600
+#define RELAY_QUEUE 4 //packets waiting for the band to go quiet
 
 #if FREQ_BAND == 433
 #define RF12_BAND RF12_433MHZ
@@ -52,6 +53,12 @@ void setupDecoders() {
   decoders[di++] = &orscV1;
   decoders[di++] = &kaku;
 }
+//ms the band has to be quiet before relaying, longer than the repeat gap
+uint8_t relayQuiet(DecodeOOK* decoder) {
+  if (decoder == &kaku)
+    return 15; //4 repeats, 11ms apart
+  return 30;
+}
 #else
 //868MHz
 #include "decoders868.h"
@@ -65,6 +72,12 @@ void setupDecoders() {
   decoders[di++] = &emx;
   decoders[di++] = &fsx;
 }
+//ms the band has to be quiet before relaying, longer than the repeat gap
+uint8_t relayQuiet(DecodeOOK* decoder) {
+  if (decoder == &fsx)
+    return 15; //3 repeats, 10ms apart
+  return 30;
+}
 #endif
 // End config items --------------------------------------------------------
 
@@ -72,6 +85,20 @@ void setupDecoders() {
 RF69A rf;
 uint8_t ookbuf[32];
 
+//register contexts of the relay transmitter and the OOK receiver
+uint8_t txContext[RF69A::CONTEXT_SIZE];
+uint8_t rxContext[RF69A::CONTEXT_SIZE];
+
+//decoded packets waiting to be relayed
+struct RelayPacket {
+  uint8_t len, quiet; //quiet: ms
+  uint8_t data[25];
+};
+RelayPacket relayQueue[RELAY_QUEUE];
+uint8_t relayCount = 0;
+uint8_t relayQuietMax = 0; //the longest quiet time of the queued packets
+uint16_t relayDropped = 0;
+
 void printDigits(int val) {
   // utility function for digital clock display: prints preceding colon and leading 0
   Serial.print(":");
@@ -136,14 +163,46 @@ void printOOK (class DecodeOOK* decoder) {
   decoder->resetDecoder();
 }
 
+//queue a decoded packet, it is sent by relayIdle() once the band is quiet
 void relay (class DecodeOOK* decoder) {
-  uint8_t pos;
-  const uint8_t* data = decoder->getData(pos);
-  rf.exit_receive();
-  rf12_initialize(NODEID, RF12_BAND, GROUP, 1600);
-  rf12_sendNow(0, data, pos);
-  rf12_sendWait(1);
-  rf.init(11, 42, frqkHz);
+  if (relayCount >= RELAY_QUEUE) {
+    relayDropped++;
+    return;
+  }
+  RelayPacket& p = relayQueue[relayCount++];
+  const uint8_t* data = decoder->getData(p.len);
+  memcpy(p.data, data, p.len);
+  p.quiet = relayQuiet(decoder);
+  if (p.quiet > relayQuietMax)
+    relayQuietMax = p.quiet;
+}
+
+//send all queued packets in one switch to the transmitter and back, when
+//the band has been quiet long enough for every protocol in the queue
+bool relayIdle(uint32_t quiet_us) {
+  if (relayCount == 0 || quiet_us < 1000UL * relayQuietMax)
+    return false;
+  uint32_t start = micros();
+  uint8_t n = rf.switchContext(rxContext, txContext);
+  for (uint8_t i = 0; i < relayCount; ++i) {
+    rf12_sendNow(0, relayQueue[i].data, relayQueue[i].len);
+    rf12_sendWait(1);
+  }
+  n += rf.switchContext(txContext, rxContext);
+  rf.enter_receive();
+  uint32_t blind = micros() - start;
+
+  Serial.print(F("RELAY "));
+  Serial.print(relayCount);
+  Serial.print(F(" blind "));
+  Serial.print(blind);
+  Serial.print(F(" us ("));
+  Serial.print(n);
+  Serial.print(F(" regs) dropped "));
+  Serial.println(relayDropped);
+  relayCount = 0;
+  relayQuietMax = 0;
+  return true;
 }
 
 void processBit(uint16_t pulse_dur, uint8_t signal, uint8_t rssi) {
@@ -168,11 +227,15 @@ void setup() {
   setupDecoders();
   if (di > max_decoders)
     Serial.print(F("ERROR: decoders-array too small. Memory corruption."));
-  rf12_initialize(11, RF12_BAND, 42, 1600);// calls rf69_initialize()
+  //setup for relaying, with the registers JeeLib does not program reset
+  rf12_initialize(NODEID, RF12_BAND, GROUP, 1600);// calls rf69_initialize()
+  rf.exit_receive();
+  rf.saveContext(txContext);
   //setup for OOK
   rf.init(11, 42, frqkHz);
+  rf.saveContext(rxContext);
 }
 
 void loop() {
-  rf.receiveOOK_forever(processBit);
+  rf.receiveOOK_forever(processBit, relayIdle);
 }
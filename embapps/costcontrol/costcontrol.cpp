@@ -33,19 +33,34 @@ uint8_t rxBuf[bufSize];
 #include "rf69cc.h"
 RF69CC<SpiDev0> rf;
 
+#include "crc.h"
+#include "descramb.h"
+
 #define VERBOSE 1
+#define FASTSWITCH 1    // switch RX/TX by saved register contexts, 0: re-init
+#define STREAMRX 1      // decode while the frame arrives, 0: fixed 56 byte payload
 #define EC3KLEN   41    // length of Energy Count 3000 packet
 
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-// Energy Count 3000 utilities
-
-uint16_t crc_ccitt_update(uint16_t crc, uint8_t data) {
-	data ^= crc & 0xFF;
-	data ^= data << 4;
+volatile uint32_t ticks = 0; // milliseconds
+extern "C" void SysTick_Handler(void) {
+	ticks++;
+}
 
-	return ((((uint16_t) data << 8) | (crc >> 8)) ^ (uint8_t) (data >> 4)
-			^ ((uint16_t) data << 3));
+// clock cycles since start-up, from the ms ticks and the SysTick count. The
+// SysTick interrupt can come between reading ticks and VAL, then VAL has
+// wrapped for a tick not yet counted, so read again until ticks holds still.
+static uint32_t cycles() {
+	uint32_t t, val;
+	do {
+		t = ticks;
+		val = SysTick->VAL;
+	} while (t != ticks);
+	return t * (SysTick->LOAD + 1) + SysTick->LOAD - val;
 }
+#define CYCLES() cycles()
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// Energy Count 3000 utilities
 
 static uint16_t mem2word(uint8_t * data)  // convert 2 bytes to word
 		{
@@ -104,68 +119,6 @@ static void del0bitins_revbits(unsigned char * buff, uint8_t blen) {
 		buff[di] = dval >> (uint8_t) (8 - dbi);
 }
 
-static uint8_t count1bits(uint32_t v) {
-	uint8_t c; // c accumulates the total bits set in v
-	for (c = 0; v; c++) {
-		v &= v - 1; // clear the least significant bit set
-	}
-	return c;
-}
-
-// generic multiplicative (self-synchronizing) de-scrambler
-//  descramble Energy Count 3000 packets needs only the polynomial
-//  x^18+x^17+x^13+x^12+x+1 (0x31801) plus bit-inversion, equivalant
-//  to Non-Return-to-Zero-Space (NRZS) and polynomial x^17+x^12+1 and
-//  to Non-Return-to-Zero-Inverted (NRZI) and polynomial x^17+x^12+1
-//  plus bit-inversion
-//  scrambler polynomial hexadecimal representation with exponents
-//  as 1-relative bit numbers and an implicit + 1 term
-//  e.g. 0x8810 for CRC-16-CCITT polynomial x^16 + x^12 + x^5 + 1
-//         x^16       + x^12                + x^5             + 1
-//  0x8810  1  0  0  0   1  0  0  0   0  0  0  1   0  0  0  0
-//         16 15 14 13  12 11 10  9   8  7  6  5   4  3  2  1
-//  see http://www.hackipedia.org/Checksums/CRC/html/Cyclic_redundancy_check.htm
-//      "Specification of CRC" and "Representations...(reverse of reciprocal)"
-//  and http://www.ece.cmu.edu/%7Ekoopman/roses/dsn04/koopman04_crc_poly_embedded.pdf
-//      "hexadecimal representation" on page 2 in section "2.Background"
-//  descramblers for Energy Count 3000 found with Berlekamp-Massey algorithm:
-//    2111 1111 111             polynomial exponents 20..1
-//          0987 6543 2109 8765 4321
-//  0x10800    1 0000 1000 0000 0000  x^17+x^12+1
-//  0x31801   11 0001 1000 0000 0001  x^18+x^17+x^13+x^12+x+1
-//  0x52802  101 0010 1000 0000 0010  x^19+x^17+x^14+x^12+x^2+1
-//  0xF7807 1111 0111 1000 0000 0111  20,19,18,17,15,14,13,12,3,2,1
-//  ITU-T V.52 PN9 PseudoRandomBitSequence, see RFM22 and trc103 manuals:
-//    0x110              1 0001 0000  x^9+x^5+1
-//  IEEE 802.11b scrambler, see "4.4 Scrambler" page 16 (PDF page 17)
-//  in http://epubl.ltu.se/1402-1617/2001/066/LTU-EX-01066-SE.pdf
-//     0x48                 100 1000  x^7+x^4+1
-//  descramb() takes 3328 .. 3524 usec per 70 byte block
-//
-#define SCRAMPOLY  0x31801  // polynomial x^18+x^17+x^13+x^12+x+1
-
-static void descramb(uint8_t* buff, uint16_t len) {
-	uint8_t ibit, obit;
-	uint8_t bit;
-	uint8_t inpbyte, outbyte;
-	uint32_t scramshift;
-
-	//scramshift = 0xFFFFFFFF;
-	scramshift = 0xF185D3AC; //descrambler primed at end of preanble
-	while (len--) {
-		inpbyte = *buff;
-		for (bit = 0; bit < 8; ++bit) {
-			// RFM69 receives MSBit first into bytes:
-			ibit = (inpbyte & 0x80) >> 7;
-			obit = ibit ^ (count1bits(scramshift & SCRAMPOLY) & 0x01);
-			scramshift = scramshift << 1 | ibit;
-			inpbyte <<= 1;
-			outbyte = outbyte << 1 | obit;
-		}
-		*buff++ = outbyte ^ 0xFF;
-	}
-}
-
 // convert descrambled Energy Count 3000 packets to interpretable format
 //  packet 'rblock' is expected descrambled with common sequence at 'offs'
 //  delete 0-bits inserted after 5 consecutive 1-bits starting at ID byte
@@ -176,20 +129,280 @@ static void descramb(uint8_t* buff, uint16_t len) {
 static uint16_t ec3kcrc;
 
 static uint8_t ec3krevshift(uint8_t idoffs, uint8_t *rblock, uint16_t rblen) {
-	uint16_t i, ec3klen;
+	uint16_t ec3klen;
 	uint16_t crc;
 
 	ec3klen = rblen - idoffs;
 	del0bitins_revbits(rblock + idoffs, ec3klen);
 	crc = 0xFFFF;
 	if (ec3klen >= EC3KLEN)
-		for (i = 0; i < EC3KLEN; ++i)
-			crc = crc_ccitt_update(crc, rblock[idoffs + i]);
+		crc = CrcCcitt::block(crc, rblock + idoffs, EC3KLEN);
 	ec3kcrc = crc;
 	lshift(rblock, rblen, 4 + idoffs * 8); //remove 4 bits of start mark '9'
 	return ec3klen;
 }
 
+//  the steps of descramb() and ec3krevshift() in one pass, in place: descramble,
+//  delete stuffed 0-bits, reverse bits, CRC and drop the start mark. 'buff'
+//  starts with the HDLC begin flag, when done it starts with the ID byte as
+//  ec3kdecode() expects it. The bytes can be fed as they are received, the
+//  state is kept in an Ec3kStream. Done as soon as EC3KLEN bytes are in the
+//  CRC, or after a byte with an HDLC abort (7 1-bits), as the frame is broken
+//  then. ec3kcrc is valid if di reached EC3KLEN.
+//
+struct Ec3kStream {
+	uint32_t scramshift;
+	uint16_t crc, window;
+	uint8_t si, di, dval, dbi, n1bits, prev;
+	bool done;
+};
+
+static void ec3kbegin(Ec3kStream& st) {
+	st.scramshift = 0xF185D3AC; //descrambler primed at end of preanble
+	st.crc = 0xFFFF;
+	st.window = st.si = st.di = st.dval = st.dbi = st.n1bits = st.prev = 0;
+	st.done = false;
+	ec3kcrc = st.crc;
+}
+
+// process buff[st.si] up to buff[blen - 1], returns true when done
+static bool ec3kfeed(Ec3kStream& st, uint8_t *buff, uint8_t blen) {
+	uint32_t scramshift = st.scramshift;
+	uint16_t crc = st.crc;
+	uint16_t window = st.window, run;
+	uint8_t sval, dval = st.dval, bit, prev = st.prev;
+	uint8_t si, sbi, di = st.di, dbi = st.dbi, n1bits = st.n1bits;
+
+	for (si = st.si; si < blen && !st.done; ++si) {
+		sval = descrambByte(scramshift, buff[si]);
+		window = window << 8 | sval;  // last 2 descrambled bytes
+		if (si == 0)
+			continue;       // HDLC begin flag
+		run = window & window >> 1; // bit set: start of 2 1-bits
+		run &= run >> 2;  //  4 1-bits
+		run &= run >> 3;  //  7 1-bits
+		for (sbi = 0; sbi < 8; ++sbi) {
+			bit = sval & 0x80;
+			sval <<= 1;
+			if (n1bits >= 5 && bit == 0) {
+				n1bits = 0;
+				continue;     // stuffed 0-bit
+			}
+			if (bit)
+				n1bits++;
+			else
+				n1bits = 0;
+			dval = dval >> 1 | bit;
+			if (++dbi < 8)
+				continue;
+			crc = CrcCcitt::update(crc, dval);
+			if (di > 0)       // 4 bits behind, start mark '9' dropped
+				buff[di - 1] = prev << 4 | dval >> 4;
+			prev = dval;
+			dval = dbi = 0;
+			if (++di == EC3KLEN) {
+				buff[di - 1] = prev << 4;
+				ec3kcrc = crc;
+				st.done = true;
+				break;
+			}
+		}
+		if (run & 0xFF)
+			st.done = true; // HDLC abort
+	}
+	st.scramshift = scramshift;
+	st.crc = crc;
+	st.window = window;
+	st.si = si;
+	st.di = di;
+	st.dval = dval;
+	st.dbi = dbi;
+	st.n1bits = n1bits;
+	st.prev = prev;
+	return st.done;
+}
+
+//  all of a received block at once, returns the number of destuffed bytes
+static uint8_t ec3kstream(uint8_t *buff, uint8_t blen) {
+	Ec3kStream st;
+
+	ec3kbegin(st);
+	ec3kfeed(st, buff, blen);
+	return st.di;
+}
+
+// Energy Count 3000 transmitter table
+//  every transmitter sends its totals about every EC3K_INTERVAL seconds. The
+//  last values per transmitter ID are kept in a small open addressing table
+//  (linear probing, no deletes) to forward only what changed and to derive
+//  the average power and the energy since the previous frame, missed frames
+//  from the gap in the seconds total, and resets of the transmitter. When the
+//  table is full the transmitter heard longest ago is replaced. Missed frames
+//  are counted apart when another frame was forwarded in the gap, as they
+//  may have come while the radio was in transmit mode.
+#define EC3K_TRACK    16    // transmitters tracked, a power of 2
+#define EC3K_INTERVAL 5     // seconds between frames of a transmitter
+#define EC3K_PAYLEN   28    // room for the payload with all fields
+
+// payload field flags, the fields follow in this order. POWER and DWS are
+// left out when no energy was used since the previous frame.
+#define EC3K_TSEC     0x01  // 4 seconds total
+#define EC3K_OSEC     0x02  // 4 seconds on
+#define EC3K_WHRS     0x04  // 4 watt hours
+#define EC3K_WATT     0x08  // 2 actual consumption (shifted by 10)
+#define EC3K_WMAX     0x10  // 2 max. consumption (shifted by 10)
+#define EC3K_NRES     0x20  // 1 number of resets
+#define EC3K_MISSED   0x40  // 1 frames missed since the previous one
+#define EC3K_RESET    0x80  // - no previous state, or the transmitter reset
+#define EC3K_POWER    0x100 // 2 average consumption since the previous frame (shifted by 10)
+#define EC3K_DWS      0x200 // 4 watt seconds used since the previous frame
+
+struct Ec3kState {
+	uint16_t id;
+	uint16_t heard;     // value of ec3kheard when last received
+	uint16_t forwards;  // value of ec3kforwarded once that frame was forwarded
+	uint32_t tsec, osec, ws, whrs;
+	uint16_t watt, wmax;
+	uint8_t nres;
+	bool used;
+};
+
+static Ec3kState ec3ktable[EC3K_TRACK];
+static uint16_t ec3kheard;  // frames received
+static uint16_t ec3kforwarded; // frames forwarded
+static uint16_t ec3klost;   // frames missed, all transmitters
+static uint16_t ec3kmissed; // frames missed in a gap with a forward in it
+
+// find the entry of a transmitter, or claim one for it, 'fresh' if claimed
+static Ec3kState* ec3klookup(uint16_t id, bool& fresh) {
+	uint8_t i = (id ^ id >> 8) & (EC3K_TRACK - 1);
+	Ec3kState* oldest = &ec3ktable[i];
+
+	fresh = true;
+	for (uint8_t n = 0; n < EC3K_TRACK; ++n, i = (i + 1) & (EC3K_TRACK - 1)) {
+		Ec3kState* s = &ec3ktable[i];
+		if (!s->used) {
+			s->used = true;
+			s->id = id;
+			return s;
+		}
+		if (s->id == id) {
+			fresh = false;
+			return s;
+		}
+		if ((uint16_t) (ec3kheard - s->heard) > (uint16_t) (ec3kheard - oldest->heard))
+			oldest = s;
+	}
+	oldest->id = id;  // full: the table never gets an empty slot again
+	return oldest;
+}
+
+static uint8_t putlong(uint8_t *p, uint32_t v) {
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+	return 4;
+}
+
+// update the transmitter state and fill the payload with the changed fields
+//  output format:
+//    ec3k sender id (2), field flags (2), then the fields in the flags
+//  returns the payload length, 0 for a repeated frame
+static uint8_t ec3kpayload(uint16_t id, uint32_t tsec, uint32_t osec, uint32_t Ws,
+		uint32_t Whrs, uint16_t Watt, uint16_t Wmax, uint8_t nres, uint8_t *payl) {
+	bool fresh;
+	uint16_t flags = 0;
+	uint8_t missed = 0, plen;
+	uint32_t dt = 0, dws = 0, power = 0;
+
+	++ec3kheard;
+	Ec3kState* s = ec3klookup(id, fresh);
+	if (!fresh && tsec == s->tsec && nres == s->nres)
+		return 0;       // same frame received again
+	if (fresh || nres != s->nres || tsec < s->tsec) {
+		flags = EC3K_RESET | EC3K_TSEC | EC3K_OSEC | EC3K_WHRS | EC3K_WATT
+				| EC3K_WMAX | EC3K_NRES;
+	} else {
+		dt = tsec - s->tsec;
+		dws = Ws - s->ws;
+		if (dt > EC3K_INTERVAL + EC3K_INTERVAL / 2) {
+			uint32_t gap = (dt + EC3K_INTERVAL / 2) / EC3K_INTERVAL - 1;
+			missed = gap < 255 ? gap : 255;
+			flags |= EC3K_MISSED;
+			ec3klost += missed;
+			if (ec3kforwarded != s->forwards)
+				ec3kmissed += missed;
+		}
+		if (dws != 0) {
+			// dws * 10 / dt without overflow and without 64 bit division
+			power = dws / dt * 10 + dws % dt * 10 / dt;
+			if (power > 0xFFFF)
+				power = 0xFFFF;
+			flags |= EC3K_POWER | EC3K_DWS;
+		}
+		flags |= EC3K_TSEC;
+		if (osec != s->osec)
+			flags |= EC3K_OSEC;
+		if (Whrs != s->whrs)
+			flags |= EC3K_WHRS;
+		if (Watt != s->watt)
+			flags |= EC3K_WATT;
+		if (Wmax != s->wmax)
+			flags |= EC3K_WMAX;
+	}
+	s->heard = ec3kheard;
+	s->forwards = ec3kforwarded + 1;  // this frame is forwarded next
+	s->tsec = tsec;
+	s->osec = osec;
+	s->ws = Ws;
+	s->whrs = Whrs;
+	s->watt = Watt;
+	s->wmax = Wmax;
+	s->nres = nres;
+
+#if VERBOSE
+	printf("$ 22 %d %d %d %d %d %d %d", id, tsec, osec, Whrs, Watt, Wmax, nres);
+	printf("\r\n");
+	if (flags & EC3K_RESET)
+		printf("EC3K %d reset\r\n", id);
+	else
+		printf("EC3K %d %d s %d Ws %d.%d W avg %d missed\r\n", id, dt, dws,
+				power / 10, power % 10, missed);
+#endif
+
+	payl[0] = id >> 8;       // ec3k sender id
+	payl[1] = id;
+	payl[2] = flags >> 8;
+	payl[3] = flags;
+	plen = 4;
+	if (flags & EC3K_TSEC)
+		plen += putlong(payl + plen, tsec);
+	if (flags & EC3K_OSEC)
+		plen += putlong(payl + plen, osec);
+	if (flags & EC3K_WHRS)
+		plen += putlong(payl + plen, Whrs);
+	if (flags & EC3K_WATT) {
+		payl[plen++] = Watt >> 8;
+		payl[plen++] = Watt;
+	}
+	if (flags & EC3K_WMAX) {
+		payl[plen++] = Wmax >> 8;
+		payl[plen++] = Wmax;
+	}
+	if (flags & EC3K_NRES)
+		payl[plen++] = nres;
+	if (flags & EC3K_MISSED)
+		payl[plen++] = missed;
+	if (flags & EC3K_POWER) {
+		payl[plen++] = power >> 8;
+		payl[plen++] = power;
+	}
+	if (flags & EC3K_DWS)
+		plen += putlong(payl + plen, dws);
+	return plen;
+}
+
 // report Energy Count 3000 packet data
 //      EC3k packet offsets (offs9) below start with "9" before ID
 //                             1     1   1   1                   2   3   3   3   3 3 3   4 4
@@ -229,7 +442,7 @@ static uint8_t ec3kdecode(uint8_t *ec3kpkt, uint8_t *payl) {
 	uint16_t id, lswsec, mswsec, Watt, Wmax;
 	uint16_t Wshi, Wsmid, Wslo;
 	uint8_t nres, onoff;
-	uint32_t tsec, osec, Whrs;
+	uint32_t tsec, osec, Ws, Whrs;
 
 	id = mem2word(ec3kpkt + 0);
 	lswsec = mem2word(ec3kpkt + 2);
@@ -266,52 +479,8 @@ static uint8_t ec3kdecode(uint8_t *ec3kpkt, uint8_t *payl) {
 #if VERBOSE
 	printf(" %d.%d W %d.%d Wmax %d resets\r\n", Watt / 10, Watt % 10, Wmax / 10, Wmax % 10, nres);
 #endif
-	//TODO: Update comment
-	//TODO: Send Ws or kWs in stead of kWh (no loss of precision)
-	// ---------------------------------------------------------------------------------------
-	// - crc calc algorithm is unknown.
-	//
-	// output format:
-	//   01 - static jeenode id 22 (defined in nodemap.local)
-	//   02 - ec3k sender id
-	//   03 - seconds total
-	//   04 - seconds on
-	//   05 - watt hours
-	//   06 - actual consumption (shifted by 10)
-	//   07 - max. consumption (shifted by 10)
-	//   08 - number of resets
-	// ---------------------------------------------------------------------------------------
-
-	//uint8_t payl[20];
-	//TODO: check len of payl is len of tXBuf is sufficient
-	uint8_t plen = 0;
-	payl[0] = id >> 8;       // ec3k sender id
-	payl[1] = id;
-	payl[2] = tsec >> 24;    // seconds total
-	payl[3] = tsec >> 16;
-	payl[4] = tsec >> 8;
-	payl[5] = tsec;
-	payl[6] = osec >> 24;    // seconds on
-	payl[7] = osec >> 16;
-	payl[8] = osec >> 8;
-	payl[9] = osec;
-	payl[10] = Whrs >> 24;    // watt hours
-	payl[11] = Whrs >> 16;
-	payl[12] = Whrs >> 8;
-	payl[13] = Whrs;
-	payl[14] = Watt >> 8;     // actual watt consumption
-	payl[15] = Watt;
-	payl[16] = Wmax >> 8;     // watt max
-	payl[17] = Wmax;
-	payl[18] = nres;          // resets
-	plen = 19;
-
-#if VERBOSE
-	printf("$ 22 %d %d %d %d %d %d %d", id, tsec, osec, Whrs, Watt, Wmax, nres);
-	printf("\r\n");
-#endif
-
-	return plen;
+	Ws = (uint32_t) Wsmid << 16 | Wslo;
+	return ec3kpayload(id, tsec, osec, Ws, Whrs, Watt, Wmax, nres, payl);
 }
 
 // hexadecimal dump data bytes
@@ -333,6 +502,15 @@ static void hexdump(uint8_t * data, uint16_t dlen) {
 	hexdumpspc(data, dlen, 0);
 }
 
+// decode the frame in rxBuf if it is complete and its CRC is valid
+//
+static uint8_t ec3kcheck(uint8_t ec3klen, uint8_t *ec3kPacket) {
+	printf("ec3klen %d, ec3kcrc %04X\r\n", ec3klen, ec3kcrc);
+	if (ec3klen >= EC3KLEN && ec3kcrc == 0xF0B8) /* from ec3kfeed() or ec3krevshift() */
+		return ec3kdecode((uint8_t*) rxBuf, ec3kPacket);
+	return 0;
+}
+
 static int processrecv(bool do_EC3K, uint8_t descram, uint8_t *ec3kPacket) {
 	uint8_t bitoffs = 0;
 	uint8_t ec3klen;
@@ -351,24 +529,20 @@ static int processrecv(bool do_EC3K, uint8_t descram, uint8_t *ec3kPacket) {
 	//can be done, but 0x7E is used in crc and bit-de-stuffing (should not?)
 	//bitoffs = 0; //because matched on last 5 bytes of preamble + HDLC 0x7E
 
-	if (descram) {
+	if (descram == 0x0C) {
+		ec3klen = ec3kstream((uint8_t*) rxBuf, rxSize); // all steps in one pass
+	} else if (descram) {
 		descramb((uint8_t*) rxBuf, rxSize);
-		if (descram != 0x0C) {
-			printf("dscr");
-			hexdump((uint8_t*) rxBuf, rxSize);
-		}
-		if (descram == 0x0C || descram == 0x0D) {
+		printf("dscr");
+		hexdump((uint8_t*) rxBuf, rxSize);
+		if (descram == 0x0D) {
 			ec3klen = ec3krevshift(bitoffs / 8, (uint8_t*) rxBuf, rxSize);
-			if (descram != 0x0C) {
-				printf("ec3k");
-				hexdump((uint8_t*) rxBuf, ec3klen);
-			}
-			printf("ec3klen %d, ec3kcrc %04X\r\n", ec3klen, ec3kcrc);
-			if (ec3klen >= EC3KLEN && ec3kcrc == 0xF0B8) { /* from ec3krevshift() */
-				ec3kvalidlen = ec3kdecode((uint8_t*) rxBuf, ec3kPacket);
-			}
+			printf("ec3k");
+			hexdump((uint8_t*) rxBuf, ec3klen);
 		}
 	}
+	if (descram == 0x0C || descram == 0x0D)
+		ec3kvalidlen = ec3kcheck(ec3klen, ec3kPacket);
 	return ec3kvalidlen;
 }
 
@@ -441,13 +615,30 @@ int main() {
 	printf("\n[costcontrol] dev %x node %d\n", devId, nodeId);
 	printf("Cost Control RT-110 / Energy Count 3000 receiver\n");
 
+	SysTick_Config(SystemCoreClock / 1000);
+
 	rf.init(nodeId, 42, 868300);
 	//rf.encrypt("mysecret");
 	rf.txPower(0); // 0 = min .. 31 = max
+#if FASTSWITCH
+	static uint8_t txContext[RF69CC<SpiDev0>::CONTEXT_SIZE];
+	static uint8_t rxContext[RF69CC<SpiDev0>::CONTEXT_SIZE];
+	rf.saveContext(txContext);
+#endif
 
 	rf.initCCreceive(868299); //63 = catch all packets, 0xAA is EC3000 syncword
 	rf.setBitrate(20000);
-	rf.setPayloadLen(56);
+	rf.setPayloadLen(STREAMRX ? 0 : 56); // 0: unlimited, ended by restartRx()
+#if FASTSWITCH
+	rf.saveContext(rxContext);
+#endif
+#if VERBOSE
+	uint32_t blindMax = 0, blindSum = 0, blinds = 0; // us, us, windows
+#endif
+#if STREAMRX
+	Ec3kStream stream;
+	ec3kbegin(stream);
+#endif
 
 	uint16_t cnt = 0;
 
@@ -459,6 +650,21 @@ int main() {
 //            rf.send(0, txBuf, sizeof txBuf);
 //        }
 
+		const int TXLEN = EC3K_PAYLEN;
+		static uint8_t txBuf[TXLEN];
+		uint8_t cnt = 0;
+
+#if STREAMRX
+		int len = rf.receive_stream(rxBuf, sizeof rxBuf);
+		uint8_t rssi = rf.rssi;
+		if (len == 0)
+			ec3kbegin(stream); // dropped by the receiver
+		if (len > 0 && (ec3kfeed(stream, rxBuf, len) || len == bufSize)) {
+			rf.restartRx(); // look for the next frame while this one is reported
+			cnt = ec3kcheck(stream.di, txBuf);
+			ec3kbegin(stream);
+		}
+#else
 		int len = rf.receive_fixed(rxBuf, sizeof rxBuf);
 		uint8_t rssi = rf.rssi;
 		if (len >= 0) {
@@ -483,27 +689,57 @@ int main() {
 			bool do_EC3K = true;
 			rxSize = len;
 
-			const int TXLEN = 1; // can be set to anything from 1 to 65
-			static uint8_t txBuf[TXLEN];
-
-			uint8_t cnt = processrecv(do_EC3K, descram, txBuf);  //  process+report received block
-			if (cnt>0) {
-				printf("transmitting %d bytes\r\n", cnt);
-				//Switch to JeeNode transmit mode
-				rf.exitCCreceive();
-				rf.init(nodeId, 42, 868300);
-				rf.send(0, txBuf, cnt);
-				//Switch back to Cost Control / EC3K receive mode
-				rf.initCCreceive(868299); //868299kHz is optimal according to AFC.
-				rf.setBitrate(20000);
-				rf.setPayloadLen(56);
-
-				//dump to console for "JeeLink mode"
-				printf("OK %02X%02X", cnt + 2, nodeId);
-				for (int ix = 0; ix < cnt; ix++)
-					printf("%02X", txBuf[ix]);
-				printf(" (%02X)\r\n", rssi);
-			}
+			cnt = processrecv(do_EC3K, descram, txBuf);  //  process+report received block
+		}
+#endif
+		if (cnt>0) {
+			printf("transmitting %d bytes\r\n", cnt);
+			uint32_t start = CYCLES();
+			//Switch to JeeNode transmit mode
+#if FASTSWITCH
+			uint8_t nregs = rf.switchContext(rxContext, txContext);
+#else
+			rf.exitCCreceive();
+			rf.init(nodeId, 42, 868300);
+#endif
+			uint32_t sending = CYCLES();
+			rf.send(0, txBuf, cnt);
+			uint32_t sent = CYCLES();
+			//Switch back to Cost Control / EC3K receive mode
+#if FASTSWITCH
+			nregs += rf.switchContext(txContext, rxContext);
+#else
+			rf.initCCreceive(868299); //868299kHz is optimal according to AFC.
+			rf.setBitrate(20000);
+			rf.setPayloadLen(STREAMRX ? 0 : 56);
+#endif
+			uint32_t done = CYCLES();
+			++ec3kforwarded;
+
+			//dump to console for "JeeLink mode"
+			printf("OK %02X%02X", cnt + 2, nodeId);
+			for (int ix = 0; ix < cnt; ix++)
+				printf("%02X", txBuf[ix]);
+			printf(" (%02X)\r\n", rssi);
+#if VERBOSE
+			//blind window: switching + sending + switching back, and the
+			//worst and mean one to compare FASTSWITCH 0 and 1
+			uint32_t perUs = SystemCoreClock / 1000000;
+			uint32_t blind = (done - start) / perUs;
+			if (blind > blindMax)
+				blindMax = blind;
+			blindSum += blind;
+			++blinds;
+			printf("blind %d us (switch %d+%d us", blind,
+					(sending - start) / perUs, (done - sent) / perUs);
+#if FASTSWITCH
+			printf(", %d regs", nregs);
+#endif
+			printf("), worst %d us, mean %d us\r\n", blindMax,
+					blindSum / blinds);
+			printf("forwarded %d, missed %d in gaps with a forward, %d in all\r\n",
+					ec3kforwarded, ec3kmissed, ec3klost);
+#endif
 		}
 
 	chThdYield()
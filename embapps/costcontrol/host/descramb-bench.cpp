@@ -0,0 +1,103 @@
+//============================================================================
+// Name        : descramb-bench.cpp
+// Description : Host check and benchmark of the EC3K descrambler
+//
+// Checks descramb() of descramb.h against the bit-serial descrambler it
+// replaced, on random blocks of 0..70 bytes, and descrambByte() fed in
+// random chunks as ec3kfeed() does. Then times both on a 70 byte block.
+// Exits with 1 on a mismatch.
+//============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../descramb.h"
+
+// the descramb() of costcontrol.cpp before the byte-wise version
+static uint8_t count1bits(uint32_t v) {
+	uint8_t c; // c accumulates the total bits set in v
+	for (c = 0; v; c++) {
+		v &= v - 1; // clear the least significant bit set
+	}
+	return c;
+}
+
+static void descrambRef(uint8_t* buff, uint16_t len) {
+	uint8_t ibit, obit;
+	uint8_t bit;
+	uint8_t inpbyte, outbyte = 0;
+	uint32_t scramshift;
+
+	scramshift = 0xF185D3AC; //descrambler primed at end of preanble
+	while (len--) {
+		inpbyte = *buff;
+		for (bit = 0; bit < 8; ++bit) {
+			// RFM69 receives MSBit first into bytes:
+			ibit = (inpbyte & 0x80) >> 7;
+			obit = ibit ^ (count1bits(scramshift & SCRAMPOLY) & 0x01);
+			scramshift = scramshift << 1 | ibit;
+			inpbyte <<= 1;
+			outbyte = outbyte << 1 | obit;
+		}
+		*buff++ = outbyte ^ 0xFF;
+	}
+}
+
+static double nanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// best time of one call in ns, over a number of rounds
+template<typename F>
+static double timeIt(F f, uint8_t* buf, const uint8_t* in, uint16_t len) {
+	const int calls = 1000;
+	double best = 1e30;
+	for (int r = 0; r < 20; ++r) {
+		double t0 = nanos();
+		for (int i = 0; i < calls; ++i) {
+			memcpy(buf, in, len);
+			f(buf, len);
+		}
+		double t = (nanos() - t0) / calls;
+		if (t < best)
+			best = t;
+	}
+	return best;
+}
+
+int main() {
+	uint8_t in[70], ref[70], out[70];
+	int bad = 0;
+	srand(1);
+	for (int n = 0; n < 200000; ++n) {
+		uint16_t len = rand() % 71;
+		for (uint16_t i = 0; i < len; ++i)
+			in[i] = rand();
+		memcpy(ref, in, len);
+		descrambRef(ref, len);
+		memcpy(out, in, len);
+		descramb(out, len);
+		if (memcmp(ref, out, len) != 0 && bad++ < 5)
+			printf("descramb: block %d of %d bytes differs\n", n, len);
+		// in chunks, with the state carried over as in ec3kfeed()
+		uint32_t scramshift = 0xF185D3AC;
+		for (uint16_t i = 0; i < len; ) {
+			uint16_t end = i + rand() % 9;
+			for (; i < end && i < len; ++i)
+				out[i] = descrambByte(scramshift, in[i]);
+		}
+		if (memcmp(ref, out, len) != 0 && bad++ < 5)
+			printf("descrambByte: block %d of %d bytes differs\n", n, len);
+	}
+	printf("200000 random blocks of 0..70 bytes: %s\n", bad ? "MISMATCH" : "ok");
+
+	uint8_t buf[70];
+	double tRef = timeIt(descrambRef, buf, in, 70);
+	double tNew = timeIt(descramb, buf, in, 70);
+	printf("70 byte block: bit-serial %.0f ns, byte-wise %.0f ns\n", tRef, tNew);
+	return bad ? 1 : 0;
+}
@@ -1,5 +1,23 @@
 // ELV Cost Control / Energy Count 3000 - RF69 driver.
 
+#ifndef RF69CC_DEBUG
+#define RF69CC_DEBUG 0 // print RSSI, LNA, AFC and FEI of each frame
+#endif
+
+// configuration registers kept in a context, the others hold status or
+// commands, or are not used here (AES key, listen mode)
+static const uint8_t contextRegs[] = {
+		0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, // modulation, freq
+		0x0B,                                           // afc ctrl
+		0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,       // pa, ocp
+		0x18, 0x19, 0x1A, 0x1E,                         // lna, rxbw, afc
+		0x25, 0x26,                                     // dio, clkout
+		0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E,             // rssi, preamble
+		0x2F, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, // sync value
+		0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D,       // packet, fifo
+		0x58, 0x5A, 0x5C, 0x6F, 0x71,                   // test regs
+		};
+
 template<typename SPI>
 class RF69CC: public RF69<SPI> {
 public:
@@ -9,6 +27,13 @@ public:
 	void setBitrate(uint32_t br);
 	void setPayloadLen(uint32_t plen);
 	int receive_fixed(void* ptr, int len);
+	int receive_stream(void* ptr, int len);
+	void restartRx();
+
+	// saved register contexts, to switch between modes without a re-init
+	enum { CONTEXT_SIZE = sizeof contextRegs };
+	void saveContext(uint8_t* ctx);
+	uint8_t switchContext(const uint8_t* from, const uint8_t* to);
 
 protected:
 	enum {
@@ -52,6 +77,7 @@ protected:
 		PCFG2_RXRESTART = 1 << 2,
 	};
 	uint16_t fei;
+	uint8_t rxfill; // bytes of the current frame read by receive_stream()
 };
 
 // driver implementation
@@ -112,7 +138,7 @@ static const uint8_t configRegsCC[] = {
 		//0x37, 0x88, // PacketConfig1 = fixed, no DC-free, no filtering
 
 		0x38, 0x38, // PayloadLength = 41 payload + 2 ctrl + 3-4 postamble + 8 stuffing
-		0x3C, 0x8F, // FifoTresh, not empty, level 15
+		0x3C, 0x8F, // FifoTresh, not empty, level 15 (FIFO_CHUNK - 1)
 		0x3D, 0x12, // 0x10, // PacketConfig2, interpkt = 1, autorxrestart on
 		//0x6F, 0x20, // TestDagc Low M
 		0x6F, 0x30, // TestDagc High M
@@ -159,6 +185,41 @@ void RF69CC<SPI>::setPayloadLen(uint32_t plen) {
 	this->writeReg(REG_PAYLOADLEN, plen );
 }
 
+// read the configuration registers as set up now into ctx
+template<typename SPI>
+void RF69CC<SPI>::saveContext(uint8_t* ctx) {
+	for (uint8_t i = 0; i < CONTEXT_SIZE; ++i)
+		ctx[i] = this->readReg(contextRegs[i]);
+}
+
+// go to sleep and write the registers that differ between two saved
+// contexts, consecutive registers in one burst, returns the number written
+template<typename SPI>
+uint8_t RF69CC<SPI>::switchContext(const uint8_t* from, const uint8_t* to) {
+	uint8_t n = 0;
+
+	RF69<SPI>::sleep();
+	for (uint8_t i = 0; i < CONTEXT_SIZE; ++i) {
+		if (from[i] == to[i])
+			continue;
+#if RF69_SPI_BULK
+		uint8_t reg = contextRegs[i];
+		this->spi.enable();
+		this->spi.transfer(reg | 0x80);
+		do {
+			this->spi.transfer(to[i]);
+			++n;
+		} while (++i < CONTEXT_SIZE && contextRegs[i] == ++reg && from[i] != to[i]);
+		this->spi.disable();
+		--i;
+#else
+		this->writeReg(contextRegs[i], to[i]);
+		++n;
+#endif
+	}
+	return n;
+}
+
 static uint16_t lcnt = 0;
 template<typename SPI>
 int RF69CC<SPI>::receive_fixed(void* ptr, int len) {
@@ -181,11 +242,13 @@ int RF69CC<SPI>::receive_fixed(void* ptr, int len) {
 #else
 				this->afc = this->readReg(REG_AFCMSB) << 8;
 				this->afc |= this->readReg(REG_AFCLSB);
-				printf("RSSI %d, LNA %d, AFC %d\r\n", this->rssi, this->lna,
-						this->afc);
 				this->fei = this->readReg(REG_FEIMSB) << 8;
 				this->fei |= this->readReg(REG_FEILSB);
+#if RF69CC_DEBUG
+				printf("RSSI %d, LNA %d, AFC %d\r\n", this->rssi, this->lna,
+						this->afc);
 				printf("FEI %d\r\n", this->fei);
+#endif
 #endif
 			}
 		}
@@ -240,3 +303,64 @@ int RF69CC<SPI>::receive_fixed(void* ptr, int len) {
 	return -1;
 }
 
+// FIFO level driven receive, for setPayloadLen(0): unlimited packet length.
+//  Bytes are read as they arrive, FIFO_CHUNK at a time in one burst when the
+//  FIFO level interrupt shows a backlog, else one by one. The frame goes on
+//  until the caller calls restartRx(), so it can be longer than the FIFO,
+//  up to len. Returns the number of bytes of the frame in ptr so far, -1 if
+//  nothing new arrived, 0 if the receiver dropped the frame (timeout).
+template<typename SPI>
+int RF69CC<SPI>::receive_stream(void* ptr, int len) {
+	enum { FIFO_CHUNK = 16 };  // FifoThreshold + 1
+
+	if (this->mode != MODE_RECEIVE) {
+		this->setMode(MODE_RECEIVE);
+		rxfill = 0;
+		return -1;
+	}
+	uint8_t irq2 = this->readReg(REG_IRQFLAGS2);
+	int n = irq2 & IRQ2_FIFOLEVEL ? FIFO_CHUNK : irq2 & IRQ2_FIFONOTEMPTY ? 1 : 0;
+	if (n == 0) {
+		//Handle timeout after RSSI interrupt occurred, without receiving data
+		if (this->readReg(REG_IRQFLAGS1) & IRQ1_TIMEOUT) {
+			restartRx();
+			return 0;
+		}
+		return -1;
+	}
+	if (n > len - rxfill)
+		n = len - rxfill;
+	if (n <= 0)
+		return -1;    // full, the caller has to restart
+	if (rxfill == 0) {  // frame start, the signal is still there
+		this->rssi = this->readReg(REG_RSSIVALUE);
+		this->lna = (this->readReg(REG_LNAVALUE) >> 3) & 0x7;
+		this->afc = this->readReg(REG_AFCMSB) << 8;
+		this->afc |= this->readReg(REG_AFCLSB);
+#if RF69CC_DEBUG
+		printf("RSSI %d, LNA %d, AFC %d\r\n", this->rssi, this->lna, this->afc);
+#endif
+	}
+	uint8_t* p = (uint8_t*) ptr + rxfill;
+	rxfill += n;
+#if RF69_SPI_BULK
+	this->spi.enable();
+	this->spi.transfer(REG_FIFO);
+	while (n--)
+		*p++ = this->spi.transfer(0);
+	this->spi.disable();
+#else
+	while (n--)
+		*p++ = this->readReg(REG_FIFO);
+#endif
+	return rxfill;
+}
+
+// drop the rest of the current frame and look for the next sync word
+template<typename SPI>
+void RF69CC<SPI>::restartRx() {
+	this->writeReg(REG_PKTCONFIG2, this->readReg(REG_PKTCONFIG2) | PCFG2_RXRESTART);
+	while (this->readReg(REG_IRQFLAGS2) & IRQ2_FIFONOTEMPTY)
+		this->readReg(REG_FIFO);
+	rxfill = 0;
+}
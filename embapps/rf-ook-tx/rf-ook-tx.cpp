@@ -15,6 +15,9 @@
 #include "spi.h"
 #include "rf69.h"
 #include "rf69rc.h"
+#include "ookimage.h"
+#include "ookwave.h"
+#include "ookqueue.h"
 
 //configuration items
 uint8_t DIO2 = 15; //GPIO pin DIO2(=DATA)
@@ -25,25 +28,9 @@ uint8_t DIO2 = 15; //GPIO pin DIO2(=DATA)
 
 RF69RC<SpiDev0> rf;
 
-volatile uint32_t ticks = 0;
-volatile uint32_t pulse = 0;                //pulse duration counter
-volatile uint32_t delay = 0;                //delay duration counter
+volatile uint32_t ticks = 0;                //ms
 extern "C" void SysTick_Handler(void) {
 	ticks++;
-	if (pulse)
-		pulse--;
-	if (delay)
-		delay--;
-}
-
-bool parity_even_bit(uint16_t v) {
-	bool parity = false;  // parity will be the parity of v
-
-	while (v) {
-		parity = !parity;
-		v = v & (v - 1);
-	}
-	return parity;
 }
 
 //Continuous OOK enable transmitter
@@ -61,150 +48,160 @@ void disableOOK() {
 	LPC_GPIO_PORT->DIR[0] &= ~(1 << DIO2);
 }
 
-//Continuous OOK send one ON/OFF-pulse
-static void ookPulse(int on, int off) {
-	pulse = on / 10;
-	LPC_GPIO_PORT->SET[0] |= 1 << DIO2;
-	while (pulse)
-		;
-	pulse = off / 10;
-	LPC_GPIO_PORT->CLR[0] |= 1 << DIO2;
-	while (pulse)
-		;
+//Continuous OOK timer: MRT channel 0 in repeat interrupt mode drives DIO2
+struct MrtTimer {
+	uint32_t perUs; //clock ticks per us
+
+	uint32_t ticks(uint16_t us) {
+		return us * perUs;
+	}
+	void level(bool on) {
+		if (on)
+			LPC_GPIO_PORT->SET[0] = 1 << DIO2;
+		else
+			LPC_GPIO_PORT->CLR[0] = 1 << DIO2;
+	}
+	void start(uint32_t t) {
+		LPC_MRT->CHANNEL[0].CTRL = 0x01; //INTEN, repeat interrupt mode
+		LPC_MRT->CHANNEL[0].INTVAL = t | (1UL << 31); //LOAD now
+	}
+	void queue(uint32_t t) {
+		LPC_MRT->CHANNEL[0].INTVAL = t; //loaded when the current run ends
+	}
+	void stop() {
+		LPC_MRT->CHANNEL[0].INTVAL = 1UL << 31; //LOAD 0, timer idle
+	}
+};
+
+//Continuous OOK runs of the frame being sent, and their playback
+static OokWaveRuns ookRuns;
+static OokWave<MrtTimer> ookWave;
+
+extern "C" void MRT_IRQHandler(void) {
+	LPC_MRT->CHANNEL[0].STAT = 0x01; //clear INTFLAG
+	ookWave.expired();
 }
 
-//Packet mode OOK transmit buffer
-uint8_t ookBuf[66];
-uint8_t k = 0;
-uint8_t l = 0;
-
-//Packet mode OOK add one packet-bit to transmit buffer
-void addOutBit(uint8_t v) {
-	if (k <= 65) {
-		ookBuf[k] |= (v & 1) << (7 - l);
-		if (++l == 8) {
-			l = 0;
-			k++;
-			if (k > 65) {
-				printf("FIFO size exceeded. Partial transmission\n");
-			} else {
-				ookBuf[k] = 0;
-			}
+//Continuous OOK send ookRuns once, the timer sets the edges
+static void sendWave() {
+	ookWave.play(ookRuns, 1);
+	while (ookWave.busy())
+		chThdYield();
+}
+
+//Packet mode OOK waveform images of the last commands sent
+static OokImageCache ookCache;
+
+//Packet mode OOK frames collected for one train, all at ookTrainBr
+static RF69RC<SpiDev0>::OokFrame ookTrain[OOK_QUEUE_SIZE];
+static uint8_t ookTrainLen;
+static uint32_t ookTrainBr;
+
+//Packet mode OOK send the collected frames as one train
+static void sendTrain() {
+	if (ookTrainLen == 0)
+		return;
+	rf.setBitrate(ookTrainBr);
+	rf.sendookTrain(ookTrain, ookTrainLen);
+	ookTrainLen = 0;
+}
+
+//Packet mode OOK a cached image is about to be rebuilt: send the train first
+//if it still holds the old one
+static void releaseImage(const OokImage& img) {
+	for (uint8_t i = 0; i < ookTrainLen; ++i)
+		if (ookTrain[i].data == img.data) {
+			sendTrain();
+			return;
 		}
-	}
 }
 
-//Packet mode OOK send complete packet
-void sendPacket() {
-	if (PACKET) {
-		//pad ookBuf with OFF (=0) to fill last byte.
-		while (l)
-			addOutBit(0);
-//		for (uint8_t i = 0; i < k; ++i)
-//			printf("%02x", ookBuf[i]);
-//		printf("\n");
-		rf.sendook(0, ookBuf, k);
-	}
+//Packet mode OOK add an image to the train, with a pause of 'gap' beats of
+//10us after it. A train at another bit rate, or a full one, is sent first.
+static void addImage(const OokImage& img, uint32_t br, uint32_t gap) {
+	if (br != ookTrainBr || ookTrainLen >= OOK_QUEUE_SIZE)
+		sendTrain();
+	ookTrainBr = br;
+	RF69RC<SpiDev0>::OokFrame& f = ookTrain[ookTrainLen++];
+	f.data = img.data;
+	f.len = img.len;
+	f.gap = (gap * br / 100000 + 4) / 8;
 }
 
-static void fs20sendBits(uint16_t data, uint8_t bits) {
-	if (bits == 8) {
-		++bits;
-		data = (data << 1) | parity_even_bit(data);
-	}
-	for (uint16_t mask = 1 << (bits - 1); mask != 0; mask >>= 1) {
-		if (PACKET) {
-			uint8_t n = (data & mask ? 3 : 2);
-			for (uint8_t on = n; on > 0; on--)
-				addOutBit(1);
-			for (uint8_t off = n; off > 0; off--)
-				addOutBit(0);
-		} else {
-			int width = data & mask ? 600 : 400;
-			ookPulse(width, width);
+//Send one FS20 frame, followed by its gap. In packet mode it is added to the
+//train, sent by sendQueue().
+static void fs20Frame(uint16_t house, uint8_t addr, uint8_t cmd) {
+	if (PACKET) {
+		bool hit;
+		OokImage& img = ookCache.lookup(OokImageCache::FS20,
+				(uint32_t) house << 16 | addr << 8 | cmd, hit);
+		if (!hit) {
+			releaseImage(img);
+			if (!ookFS20(img, house, addr, cmd)) {
+				printf("FIFO size exceeded. Partial transmission\n");
+				ookCache.drop(img);
+			}
 		}
+		addImage(img, 5000, 880); //200us (5000bps) largest common divisor
+		return;
 	}
+	ookWaveFS20(ookRuns, house, addr, cmd, 8800); //8.8ms after each
+	sendWave();
 }
 
-void startOOK(uint32_t br) {
+//Send one KAKU frame, followed by its gap. In packet mode it is added to the
+//train, sent by sendQueue().
+static void kakuFrame(uint8_t addr, uint8_t device, uint8_t on) {
 	if (PACKET) {
-		//clear the ookBuf
-		k = 0;
-		l = 0;
-		ookBuf[0] = 0;
-		rf.setBitrate(br);
-	} else {
-		enableOOK();
+		bool hit;
+		OokImage& img = ookCache.lookup(OokImageCache::KAKU,
+				addr << 16 | device << 8 | on, hit);
+		if (!hit) {
+			releaseImage(img);
+			ookKaku(img, addr, device, on);
+		}
+		addImage(img, 2667, 1100); //375us (2667bps) largest common divisor
+		return;
 	}
+	ookWaveKaku(ookRuns, addr, device, on, 11000); //11ms after each
+	sendWave();
 }
 
-void stopOOK() {
-	if (PACKET) {
-		sendPacket();
-	} else {
-		disableOOK();
+//Commands waiting to be sent as one batch
+static OokQueue txQueue;
+
+//Send all queued commands in one transmit session, with their repeats
+//interleaved. In packet mode consecutive frames at one bit rate go out as one
+//train.
+static void sendQueue() {
+	uint8_t kind;
+	uint32_t key;
+	if (txQueue.empty())
+		return;
+	if (!PACKET)
+		enableOOK();
+	while (txQueue.next(kind, key)) {
+		if (kind == OokImageCache::FS20)
+			fs20Frame(key >> 16, key >> 8, key);
+		else
+			kakuFrame(key >> 16, key >> 8, key);
 	}
+	if (PACKET)
+		sendTrain();
+	else
+		disableOOK();
 }
 
 static void fs20cmd(uint16_t house, uint8_t addr, uint8_t cmd) {
-	uint8_t sum = 6 + (house >> 8) + house + addr + cmd;
-	for (uint8_t i = 0; i < 3; ++i) {
-		startOOK(5000); //PACKET mode: 200us (5000bps) largest common divisor
-		fs20sendBits(1, 13);
-		fs20sendBits(house >> 8, 8);
-		fs20sendBits(house & 0xFF, 8);
-		fs20sendBits(addr, 8);
-		fs20sendBits(cmd, 8);
-		fs20sendBits(sum, 8);
-		fs20sendBits(0, 1);
-		stopOOK();
-		delay = 880; //8.8ms = 1000 beats of 10us
-		while (delay)
-			;
-	}
+	if (txQueue.full())
+		sendQueue();
+	txQueue.add(OokImageCache::FS20, (uint32_t) house << 16 | addr << 8 | cmd, 3);
 }
 
 static void kakuSend(uint8_t addr, uint8_t device, uint8_t on) {
-    int cmd = 0x600 | ((device - 1) << 4) | ((addr - 1) & 0xF);
-    if (on)
-        cmd |= 0x800;
-    for (uint8_t i = 0; i < 4; ++i) {
-		startOOK(2667); //PACKET mode: 375us (2667bps) largest common divisor
-    	int sr = cmd;
-
-    	if (PACKET) {
-			for (uint8_t bit = 0; bit < 12; ++bit) {
-				addOutBit(1);
-				addOutBit(0);
-				addOutBit(0);
-				addOutBit(0);
-				//int on = bitRead(cmd, bit) ? 1125 : 375;
-				int on = sr & 1 ? 1125 : 375;
-				sr >>= 1;
-				ookPulse(on, 1500 - on);
-				uint8_t n = (sr & 1 ? 3 : 1);
-				for (uint8_t on = n; on > 0; on--)
-					addOutBit(1);
-				for (uint8_t off = 4-n; off > 0; off--)
-					addOutBit(0);
-			}
-			addOutBit(1);
-			addOutBit(0);
-    	} else {
-			for (uint8_t bit = 0; bit < 12; ++bit) {
-				ookPulse(375, 1125);
-				//int on = bitRead(cmd, bit) ? 1125 : 375;
-				int on = sr & 1 ? 1125 : 375;
-				sr >>= 1;
-				ookPulse(on, 1500 - on);
-			}
-		    ookPulse(375, 375);
-    	}
-		stopOOK();
-        delay = 1100; //11ms = 1100 beats of 10us
-		while (delay)
-			;
-    }
+	if (txQueue.full())
+		sendQueue();
+	txQueue.add(OokImageCache::KAKU, (uint32_t) addr << 16 | device << 8 | on, 4);
 }
 
 int main() {
@@ -273,8 +270,12 @@ int main() {
 		break;
 	}
 
-	const uint16_t tsample = 10; //us samples
-	SysTick_Config(SystemCoreClock / (1000000 / tsample));
+	SysTick_Config(SystemCoreClock / 1000); //ms ticks
+
+	//continuous OOK edges from the multi-rate timer
+	LPC_SYSCON->SYSAHBCLKCTRL |= 1 << 10; //MRT clock
+	ookWave.timer.perUs = SystemCoreClock / 1000000;
+	NVIC_EnableIRQ(MRT_IRQn);
 
 	uart0Init(115200);
 	for (int i = 0; i < 10000; ++i)
@@ -291,9 +292,10 @@ int main() {
 	rf.txPower(5); // 0 = min .. 31 = max
 
 	while (true) {
-		if (ticks > 500000) {
+		if (ticks > 5000) {
 			printf("Send one at %d\n", ticks);
 			fs20cmd(0x1000, 0x01, 0x12);
+			sendQueue();
 			ticks = 0;
 		}
 	chThdYield()
@@ -8,6 +8,15 @@ public:
 	void initOOKcont(uint8_t id, uint8_t group, int freq);
 	void setBitrate (uint32_t br);
 	void sendook(uint8_t header, const void* ptr, int len);
+
+	// a frame of a train and the OFF bytes sent after it
+	struct OokFrame {
+		const uint8_t* data;
+		int len;
+		uint8_t gap;
+	};
+	void sendookTrain(const void* ptr, int len, uint8_t repeats, uint8_t gap);
+	void sendookTrain(const OokFrame* frames, uint8_t count);
 	void transmitOOKOn();
 	void transmitOOKOff();
 
@@ -43,9 +52,40 @@ protected:
 		IRQ1_SYNADDRMATCH = 1 << 0,
 
 		IRQ2_FIFONOTEMPTY = 1 << 6,
+		IRQ2_FIFOLEVEL = 1 << 5,
 		IRQ2_PACKETSENT = 1 << 3,
 		IRQ2_PAYLOADREADY = 1 << 2,
+
+		FIFO_SIZE = 66,
+		FIFO_THRESH = 15, // FifoLevel set above this, see configRegsOOKpckt
+	};
+
+	// the FIFO bytes of a train: an OFF byte, then 'repeats' times each of
+	// the frames followed by its gap of OFF bytes
+	struct OokTrain {
+		const OokFrame* frames;
+		uint8_t count, cur;
+		int pos;          // -1: the leading OFF byte
+		uint8_t repeats;
+
+		bool more() {
+			return repeats > 0;
+		}
+		uint8_t next() {
+			const OokFrame& f = frames[cur];
+			uint8_t b = pos >= 0 && pos < f.len ? f.data[pos] : 0;
+			if (++pos >= f.len + f.gap) {
+				pos = 0;
+				if (++cur >= count) {
+					cur = 0;
+					--repeats;
+				}
+			}
+			return b;
+		}
 	};
+	void writeFifo(OokTrain& train, uint8_t n);
+	void sendTrain(OokTrain& train);
 };
 
 // driver implementation
@@ -68,7 +108,7 @@ static const uint8_t configRegsOOKpckt [] = {
     //0x2F, 0x00, // SyncValue1 = 0x2D
     0x37, 0x80, // PacketConfig1 = variable length, advanced items OFF
     0x38, 0x00, // PayloadLength = 0, unlimited
-    //0x3C, 0x8F, // FifoTresh, not empty, level 15
+    0x3C, 0x8F, // FifoTresh, not empty, level 15 (FIFO_THRESH)
     //0x3D, 0x12, // 0x10, // PacketConfig2, interpkt = 1, autorxrestart off
     //0x6F, 0x20, // TestDagc ...
     //0x71, 0x02, // RegTestAfc
@@ -135,28 +175,58 @@ void RF69RC<SPI>::setBitrate (uint32_t br) {
 
 template<typename SPI>
 void RF69RC<SPI>::sendook(uint8_t header, const void* ptr, int len) {
-	//this->setMode(MODE_TRANSMIT);
+	sendookTrain(ptr, len, 1, 0);
+}
 
+// write up to n bytes of a train to the FIFO, in one burst if possible
+template<typename SPI>
+void RF69RC<SPI>::writeFifo(OokTrain& train, uint8_t n) {
 #if RF69_SPI_BULK
 	this->spi.enable();
 	this->spi.transfer(REG_FIFO | 0x80);
-	//write 8 bits OFF to start with
-	this->writeReg(REG_FIFO, 0);
-	for (int i = 0; i < len; ++i)
-	this->spi.transfer(((const uint8_t*) ptr)[i]);
+	while (n-- > 0 && train.more())
+		this->spi.transfer(train.next());
 	this->spi.disable();
 #else
-	//write 8 bits OFF to start with
-	this->writeReg(REG_FIFO, 0);
-	for (int i = 0; i < len; ++i)
-		this->writeReg(REG_FIFO, ((const uint8_t*) ptr)[i]);
+	while (n-- > 0 && train.more())
+		this->writeReg(REG_FIFO, train.next());
 #endif
-//	for (int i = 0; i < len; ++i)
-//		printf("%02X", ((const uint8_t*) ptr)[i]);
-//	printf("\n");
+}
 
-	//send after filling FIFO (RFM should be in sleep or standby)
+// send a frame 'repeats' times with 'gap' OFF bytes after each, as one
+// packet of any length
+template<typename SPI>
+void RF69RC<SPI>::sendookTrain(const void* ptr, int len, uint8_t repeats,
+		uint8_t gap) {
+	OokFrame frame = { (const uint8_t*) ptr, len, gap };
+	OokTrain train = { &frame, 1, 0, -1, repeats };
+	sendTrain(train);
+}
+
+// send frames of one bit rate back to back, each followed by its gap, as
+// one packet, so a batch needs a single switch to transmit
+template<typename SPI>
+void RF69RC<SPI>::sendookTrain(const OokFrame* frames, uint8_t count) {
+	OokTrain train = { frames, count, 0, -1, 1 };
+	if (count > 0)
+		sendTrain(train);
+}
+
+// the FIFO is filled before switching to transmit, then topped up each time
+// the FifoLevel flag shows it is down to FIFO_THRESH bytes. At 5000 bps that
+// leaves 24 ms to respond.
+template<typename SPI>
+void RF69RC<SPI>::sendTrain(OokTrain& train) {
+	//fill the FIFO, starting with 8 bits OFF, and send (RFM should be in
+	//sleep or standby)
+	writeFifo(train, FIFO_SIZE);
 	this->setMode(MODE_TRANSMIT);
+	while (train.more()) {
+		if ((this->readReg(REG_IRQFLAGS2) & IRQ2_FIFOLEVEL) == 0)
+			writeFifo(train, FIFO_SIZE - FIFO_THRESH);
+		else
+			chThdYield();
+	}
 	while ((this->readReg(REG_IRQFLAGS2) & IRQ2_PACKETSENT) == 0)
 		chThdYield();
 
@@ -0,0 +1,138 @@
+/// @file
+/// Bit accumulator for the OOK decoders.
+// Bits are packed LSB first: the first bit received ends up in bit 0 of
+// data[0]. Incoming bits are collected in a 32 bit register and written out
+// four bytes at a time, so the per bit cost is a shift and an or instead of a
+// read-modify-write of the current byte. The bytes of the word being filled
+// are only valid in data[] after flush(), which nextPulse() does when a packet
+// is complete. The helpers below flush themselves.
+
+class BitBuffer {
+  protected:
+    enum { MAXBYTES = 25 };
+    uint8_t total_bits, bits, pos, data[MAXBYTES + 3];
+
+    BitBuffer () { clear(); }
+
+    void clear () {
+      total_bits = bits = pos = 0;
+      acc = 0;
+      nacc = 0;
+    }
+
+    // add one bit, returns false if the buffer overflows
+    bool put (uint8_t value) {
+      acc |= (uint32_t) (value & 1) << nacc;
+      total_bits++;
+      if (++bits >= 8) {
+        bits = 0;
+        if (++pos >= MAXBYTES)
+          return false;
+      }
+      if (++nacc == 32) {
+        storeWord(data + pos - 4, acc);
+        acc = 0;
+        nacc = 0;
+      }
+      return true;
+    }
+
+    // write the word being filled to data[], a partial last byte is right
+    // aligned
+    void flush () {
+      uint8_t* p = data + (total_bits >> 3) - (nacc >> 3);
+      uint32_t w = acc;
+      for (uint8_t n = nacc; n > 0; n = n > 8 ? n - 8 : 0) {
+        *p++ = w;
+        w >>= 8;
+      }
+    }
+
+    // move bits to the front so that all the bits are aligned to the end,
+    // i.e. drop the oldest bits of an incomplete first byte, and optionally
+    // keep only the last max bytes
+    void alignTail (uint8_t max = 0) {
+      flush();
+      if (bits != 0) {
+        uint8_t n = (pos + 3) >> 2;
+        for (uint8_t i = 0; i < n; ++i) {
+          uint32_t w = loadWord(data + 4 * i) >> bits;
+          w |= loadWord(data + 4 * i + 4) << (32 - bits);
+          storeWord(data + 4 * i, w);
+        }
+        bits = 0;
+      }
+      if (max > 0 && pos > max) {
+        uint8_t n = pos - max;
+        pos = max;
+        for (uint8_t i = 0; i < pos; ++i)
+          data[i] = data[i + n];
+      }
+      total_bits = 8 * pos;
+      reload();
+    }
+
+    void reverseBits () {
+      static const uint8_t rev[16] = {
+        0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+        0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF,
+      };
+      flush();
+      for (uint8_t i = 0; i < pos; ++i)
+        data[i] = (rev[data[i] & 0x0F] << 4) | rev[data[i] >> 4];
+      reload();
+    }
+
+    void reverseNibbles () {
+      flush();
+      for (uint8_t i = 0; i < pos; ++i)
+        data[i] = (data[i] << 4) | (data[i] >> 4);
+      reload();
+    }
+
+    // invert all bits received so far
+    void invertBits () {
+      flush();
+      for (uint8_t i = 0; i <= pos; ++i)
+        data[i] ^= 0xFF;
+      reload();
+    }
+
+    // keep only the first n bits
+    void truncate (uint8_t n) {
+      flush();
+      total_bits = n;
+      pos = n >> 3;
+      bits = n & 7;
+      reload();
+    }
+
+    // invert bit n
+    void flipBit (uint8_t n) {
+      flush();
+      data[n >> 3] ^= 1 << (n & 7);
+      reload();
+    }
+
+  private:
+    uint32_t acc;  // bits not yet stored in data[]
+    uint8_t nacc;  // number of bits in acc
+
+    static uint32_t loadWord (const uint8_t* p) {
+      return p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16
+        | (uint32_t) p[3] << 24;
+    }
+
+    static void storeWord (uint8_t* p, uint32_t w) {
+      p[0] = w;
+      p[1] = w >> 8;
+      p[2] = w >> 16;
+      p[3] = w >> 24;
+    }
+
+    // pick up the word being filled again after data[] was modified
+    void reload () {
+      nacc = total_bits & 31;
+      acc = nacc ? loadWord(data + 4 * (total_bits >> 5)) & (~(uint32_t) 0 >> (32 - nacc)) : 0;
+    }
+};
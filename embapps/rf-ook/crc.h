@@ -0,0 +1,99 @@
+/// @file
+/// Table driven CRC routines, shared by the OOK decoders and the EC3K receiver.
+// All CRCs used here are reflected (LSB first): the polynomial is given in its
+// reversed form, e.g. 0xA001 for CRC-16, 0x8408 for CRC-CCITT, 0x8C for the
+// Dallas One-Wire CRC-8. Tables are generated from the polynomial by the
+// compiler. Small targets use a 16-entry nibble table (32 bytes of flash for
+// a 16 bit CRC). Hosts process blocks 8 bytes per step with slicing-by-8
+// tables (8 KB per CRC), or 4 bytes with slicing-by-4 (4 KB). The variants
+// are compared in raspi-apps/rf-ook/host/crc-bench.cpp.
+
+#ifndef CRC_SLICING
+#if defined(__linux__) && __cplusplus >= 201402L
+#define CRC_SLICING 8  // 0 = nibble table only, 4 or 8 = bytes per step
+#else
+#define CRC_SLICING 0
+#endif
+#endif
+
+template<typename T, T POLY>
+class CrcReflected {
+	// one bit step of the shift register
+	static constexpr T step(T c) {
+		return (c & 1) ? (T) ((c >> 1) ^ POLY) : (T) (c >> 1);
+	}
+	// k bit steps
+	static constexpr T steps(T c, uint8_t k) {
+		return k ? steps(step(c), k - 1) : c;
+	}
+
+	static const T nib[16];
+
+#if CRC_SLICING
+	// slice[k][b] is the CRC of byte b followed by k zero bytes
+	struct Slices {
+		uint32_t t[CRC_SLICING][256];
+		constexpr Slices() : t() {
+			for (uint16_t b = 0; b < 256; ++b)
+				t[0][b] = steps(b, 8);
+			for (uint8_t k = 1; k < CRC_SLICING; ++k)
+				for (uint16_t b = 0; b < 256; ++b)
+					t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+		}
+	};
+	static constexpr Slices slices {};
+#endif
+
+public:
+	// add one byte to the crc
+	static T update(T crc, uint8_t a) {
+		crc ^= a;
+		crc = (crc >> 4) ^ nib[crc & 0x0F];
+		crc = (crc >> 4) ^ nib[crc & 0x0F];
+		return crc;
+	}
+
+	// add a block of bytes to the crc
+	static T block(T crc, const uint8_t* p, uint16_t len) {
+#if CRC_SLICING
+		const uint32_t (*t)[256] = slices.t;
+		uint32_t c = crc;
+#if CRC_SLICING == 8
+		for (; len >= 8; len -= 8, p += 8) {
+			c ^= p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16
+					| (uint32_t) p[3] << 24;
+			c = t[7][c & 0xFF] ^ t[6][(c >> 8) & 0xFF]
+					^ t[5][(c >> 16) & 0xFF] ^ t[4][c >> 24]
+					^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+		}
+#endif
+		for (; len >= 4; len -= 4, p += 4) {
+			c ^= p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16
+					| (uint32_t) p[3] << 24;
+			c = t[3][c & 0xFF] ^ t[2][(c >> 8) & 0xFF]
+					^ t[1][(c >> 16) & 0xFF] ^ t[0][c >> 24];
+		}
+		crc = c;
+#endif
+		while (len--)
+			crc = update(crc, *p++);
+		return crc;
+	}
+};
+
+template<typename T, T POLY>
+const T CrcReflected<T, POLY>::nib[16] = {
+	steps(0, 4), steps(1, 4), steps(2, 4), steps(3, 4),
+	steps(4, 4), steps(5, 4), steps(6, 4), steps(7, 4),
+	steps(8, 4), steps(9, 4), steps(10, 4), steps(11, 4),
+	steps(12, 4), steps(13, 4), steps(14, 4), steps(15, 4),
+};
+
+#if CRC_SLICING
+template<typename T, T POLY>
+constexpr typename CrcReflected<T, POLY>::Slices CrcReflected<T, POLY>::slices;
+#endif
+
+typedef CrcReflected<uint16_t, 0xA001> Crc16;     // CRC-16, as _crc16_update()
+typedef CrcReflected<uint16_t, 0x8408> CrcCcitt;  // CRC-CCITT, as _crc_ccitt_update()
+typedef CrcReflected<uint8_t, 0x8C> Crc8Dallas;   // Dallas One-Wire CRC-8
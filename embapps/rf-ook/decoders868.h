@@ -13,32 +13,39 @@
 class WH1080DecoderV2 : public DecodeOOK {
   protected:
     uint8_t msglen;
+    // split between bit-1 and bit-0, learned per station, see TimingCal
+    TimingCal cal;
   public:
-    WH1080DecoderV2 (uint8_t msg_len = 10, uint8_t gap = 5, uint8_t count = 0) : DecodeOOK(gap, count), msglen(msg_len) {}
-    WH1080DecoderV2 (uint8_t id, const char* tag, decoded_cb cb, uint8_t msg_len = 10, uint8_t gap = 5, uint8_t count = 0) : DecodeOOK (id, tag, cb, gap, count), msglen(msg_len) {}
-
-    //Dallas One-Wire CRC-8 - incremental calculation.
-    uint8_t crc8_update( uint8_t crc, uint8_t inuint8_t)
-    {
-      uint8_t i;
-      for (i = 8; i; i--) {
-        uint8_t mix = (crc ^ inuint8_t) & 0x01;
-        crc >>= 1;
-        if (mix) crc ^= 0x8C;
-        inuint8_t >>= 1;
-      }
-      return crc;
+    WH1080DecoderV2 (uint8_t msg_len = 10, uint8_t gap = 5, uint8_t count = 0) : DecodeOOK(gap, count), msglen(msg_len), cal(1000, 800, 1200) {
+      setPreamble(140, 1200, 10); // 15 short pulses and lows
+    }
+    WH1080DecoderV2 (uint8_t id, const char* tag, decoded_cb cb, uint8_t msg_len = 10, uint8_t gap = 5, uint8_t count = 0) : DecodeOOK (id, tag, cb, gap, count), msglen(msg_len), cal(1000, 800, 1200) {
+      setPreamble(140, 1200, 10); // 15 short pulses and lows
     }
 
     //Dallas One-Wire CRC-8.
     uint8_t crc8( const uint8_t *addr, uint8_t len)
     {
-      uint8_t crc = 0;
-      while (len--) {
-        uint8_t inuint8_t = *addr++;
-        crc = crc8_update(crc, inuint8_t);
-      }
-      return crc;
+      return Crc8Dallas::block(0, addr, len);
+    }
+
+    virtual bool validate () {
+      flush();
+      return crc8(data, msglen - 1) == data[msglen - 1];
+    }
+
+    // station id of a decoded packet, after the 0xA type nibble
+    uint16_t sensorId () const {
+      return ((data[0] & 0x0F) << 4) | (data[1] >> 4);
+    }
+
+    virtual void resetDecoder () {
+      cal.reset();
+      DecodeOOK::resetDecoder();
+    }
+
+    virtual const TimingCal* getTiming () const {
+      return &cal;
     }
 
 
@@ -46,7 +53,8 @@ class WH1080DecoderV2 : public DecodeOOK {
     // 200 < bit-1 < 800 < low < 1200 < bit-0 < 1700
     virtual int8_t decode (uint16_t width) {
       if (140 <= width && width < 2500) {
-        uint8_t w = width >= 1000;
+        uint16_t thd = cal.getSplit();
+        uint8_t w = width >= thd;
         //option 1: only looking at durations
         uint8_t is_low = (780 <= width && width < 1200);
         switch (state) {
@@ -69,7 +77,8 @@ class WH1080DecoderV2 : public DecodeOOK {
             break;
           case OK:
             if (!is_low) {
-              gotBit(!w);
+              cal.add(width, w);
+              softBit(!w, confidence(width, thd));
               state = T0;
             } else {
               //expecting high signal, got low
@@ -90,8 +99,11 @@ class WH1080DecoderV2 : public DecodeOOK {
         return -1;
       }
       if (total_bits >= msglen * 8) {
-        if (crc8(data, msglen - 1) == data[msglen - 1]) {
+        bool clean = validate();
+        if (clean || repair()) {
           reverseBits();
+          if (clean)
+            cal.learn(sensorId());
           return 1;
         } else {
           //failed crc at maximum message length
@@ -109,14 +121,19 @@ class WH1080DecoderV2 : public DecodeOOK {
 //Capable of decoding both 9 and 10 uint8_t messages (WS3000, WS4000)
 class WH1080DecoderV2a : public WH1080DecoderV2 {
   public:
-    WH1080DecoderV2a(uint8_t msg_len = 10, uint8_t gap = 5, uint8_t count = 0) : WH1080DecoderV2(msg_len, gap, count) {}
-    WH1080DecoderV2a (uint8_t id, const char* tag, decoded_cb cb, uint8_t msg_len = 10, uint8_t gap = 5, uint8_t count = 0) : WH1080DecoderV2 (id, tag, cb, msg_len, gap, count) {}
+    WH1080DecoderV2a(uint8_t msg_len = 10, uint8_t gap = 5, uint8_t count = 0) : WH1080DecoderV2(msg_len, gap, count) {
+      setPreamble(0, 0, 0); // preamble depends on the signal level
+    }
+    WH1080DecoderV2a (uint8_t id, const char* tag, decoded_cb cb, uint8_t msg_len = 10, uint8_t gap = 5, uint8_t count = 0) : WH1080DecoderV2 (id, tag, cb, msg_len, gap, count) {
+      setPreamble(0, 0, 0); // preamble depends on the signal level
+    }
 
     // see also http://lucsmall.com/2012/04/29/weather-station-hacking-part-2/
     // 200 < bit-1 < 800 < low < 1200 < bit-0 < 1700
     virtual int8_t decode (uint16_t width) {
       if (140 <= width && width < 2500) {
-        uint8_t w = width >= 1000;
+        uint16_t thd = cal.getSplit();
+        uint8_t w = width >= thd;
         //option 2: having knowledge on the signal value, we can allow for more jitter on timing
         uint8_t is_low = !last_signal;
         switch (state) {
@@ -137,7 +154,8 @@ class WH1080DecoderV2a : public WH1080DecoderV2 {
             break;
           case OK:
             if (!is_low) {
-              gotBit(!w);
+              cal.add(width, w);
+              softBit(!w, confidence(width, thd));
               state = T0;
             } else {
               //expecting high signal, got low
@@ -158,8 +176,11 @@ class WH1080DecoderV2a : public WH1080DecoderV2 {
         return -1;
       }
       if (total_bits >= msglen * 8) {
-        if (crc8(data, msglen - 1) == data[msglen - 1]) {
+        bool clean = validate();
+        if (clean || repair()) {
           reverseBits();
+          if (clean)
+            cal.learn(sensorId());
           return 1;
         } else {
           //failed crc at maximum message length
@@ -196,8 +217,7 @@ class VisonicDecoder : public DecodeOOK {
             break;
         }
         // sync error, flip all the preceding bits to resync
-        for (uint8_t i = 0; i <= pos; ++i)
-          data[i] ^= 0xFF;
+        invertBits();
       } else if (width >= 2500 && 8 * pos + bits >= 36 && state == OK) {
         for (uint8_t i = 0; i < 4; ++i)
           gotBit(0);
@@ -215,8 +235,12 @@ class VisonicDecoder : public DecodeOOK {
 /// OOK decoder for FS20 type EM devices.
 class EMxDecoder : public DecodeOOK {
   public:
-    EMxDecoder () : DecodeOOK (30) {} // ignore packets repeated within 3 sec
-    EMxDecoder (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb, 30) {} // ignore packets repeated within 3 sec
+    EMxDecoder () : DecodeOOK (30) { // ignore packets repeated within 3 sec
+      setPreamble(200, 600, 12); // more than 20 short pulses
+    }
+    EMxDecoder (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb, 30) { // ignore packets repeated within 3 sec
+      setPreamble(200, 600, 12); // more than 20 short pulses
+    }
 
     // see also http://fhz4linux.info/tiki-index.php?page=EM+Protocol
     virtual int8_t decode (uint16_t width) {
@@ -251,9 +275,11 @@ class EMxDecoder : public DecodeOOK {
 
 /// OOK decoder for FS20 type KS devices.
 class KSxDecoder : public DecodeOOK {
+  private:
+    uint8_t sync;
   public:
-    KSxDecoder () {}
-    KSxDecoder (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb) {}
+    KSxDecoder () : sync(0) {}
+    KSxDecoder (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb), sync(0) {}
 
     // see also http://www.dc3yc.homepage.t-online.de/protocol.htm
     virtual int8_t decode (uint16_t width) {
@@ -261,10 +287,10 @@ class KSxDecoder : public DecodeOOK {
         uint8_t w = width >= 600;
         switch (state) {
           case UNKNOWN:
-            gotBit(w);
-            bits = pos = 0;
-            if (data[0] != 0x95)
-              state = UNKNOWN;
+            // slide over the incoming bits until the sync byte shows up
+            sync = (sync >> 1) | (w << 7);
+            if (sync == 0x95)
+              state = OK;
             break;
           case OK:
             state = w == 0 ? T0 : T1;
@@ -291,8 +317,12 @@ class KSxDecoder : public DecodeOOK {
 /// OOK decoder for FS20 type FS devices.
 class FSxDecoder : public DecodeOOK {
   public:
-    FSxDecoder () {}
-    FSxDecoder (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb) {}
+    FSxDecoder () {
+      setPreamble(200, 500, 12); // more than 18 short pulses
+    }
+    FSxDecoder (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb) {
+      setPreamble(200, 500, 12); // more than 18 short pulses
+    }
 
     // see also http://fhz4linux.info/tiki-index.php?page=FS20%20Protocol
     virtual int8_t decode (uint16_t width) {
@@ -7,6 +7,8 @@
 //
 //============================================================================
 #define STATLOG 1
+#define OOK_STATS 0 //per decoder counters, dump with 's'
+#define READINGS 0 //append decoded values to printOOK lines, see payloads.h
 
 #include "chip.h"
 #include "uart.h"
@@ -41,11 +43,15 @@ extern "C" void SysTick_Handler(void) {
 }
 
 RF69A<SpiDev0> rfa;
+#define OOK_TENTHS() (sampleTicks / (100000 / tsample)) //no millis() here
+#define OOK_CYCLES() (sampleTicks * (SysTick->LOAD + 1) + SysTick->LOAD - SysTick->VAL) //M0+ has no DWT
 #include "decodeOOK.h"
+#include "payloads.h"
 //#include "decodeOOK_TEST.h"
 
 const uint8_t max_decoders = 6; //Too many decoders slows processing down.
 DecodeOOK* decoders[max_decoders] = { NULL };
+PreambleGate gate; //skips parked decoders until their preamble shows up
 uint8_t di = 0;
 void printOOK(class DecodeOOK* decoder); //void relay (class DecodeOOK* decoder);
 
@@ -54,23 +60,24 @@ void printOOK(class DecodeOOK* decoder); //void relay (class DecodeOOK* decoder)
 #include "decoders433.h"
 //OregonDecoderV2   orscV2(  5, "ORSV2", printOOK);
 //CrestaDecoder     cres(    6, "CRES ", printOOK);
-KakuDecoder kaku( 7, "KAKU ", printOOK);
+//KakuDecoder kaku( 7, "KAKU ", printOOK);
 //XrfDecoder        xrf(     8, "XRF  ", printOOK);
 //HezDecoder        hez(     9, "HEZ  ", printOOK);
 //ElroDecoder       elro(   10, "ELRO ", printOOK);
 //FlamingoDecoder   flam(   11, "FMGO ", printOOK);
 //SmokeDecoder      smok(   12, "SMK  ", printOOK);
-//ByronbellDecoder  byro(   13, "BYR  ", printOOK);
+//Byron SX30T: BYR row of PwmDecoder
 //KakuADecoder      kakuA(  14, "KAKUA", printOOK);
 WS249 ws249( 20, "WS249", printOOK);
 Philips phi( 21, "PHI  ", printOOK);
 OregonDecoderV1 orscV1( 22, "ORSV1", printOOK);
 //OregonDecoderV3   orscV3( 23, "ORSV3", printOOK);
+PwmDecoder pwm( 30, "PWM  ", printOOK); //KAKU and RcSwitch protocols, see pwmProtocols433
 void setupDecoders() {
 	decoders[di++] = &ws249;
 	decoders[di++] = &phi;
 	decoders[di++] = &orscV1;
-	decoders[di++] = &kaku;
+	decoders[di++] = &pwm;
 }
 #else
 //868MHz
@@ -109,6 +116,60 @@ void printRSSI() {
 			avgonrssi >> (RSSI_BUF_EXP - 1));
 }
 
+#if READINGS
+void printTemp(int16_t temp) {
+	uint16_t t = temp < 0 ? -temp : temp;
+	printf(" %s%d.%dC", temp < 0 ? "-" : "", t / 10, t % 10);
+}
+
+// append the typed reading of packets with a known layout, see payloads.h
+void printReading(class DecodeOOK* decoder, const uint8_t* data, uint8_t pos) {
+	ClimateReading c;
+	SwitchCommand s;
+	FS20Command f;
+	EnergyReading e;
+	bool climate = false, kaku = false;
+	switch (decoder->id) {
+	case 22: //ORSV1
+		climate = parseOregonV1(data, pos, c);
+		break;
+	case 5: //ORSV2
+	case 23: //ORSV3
+		climate = parseOregon(data, pos, c);
+		break;
+	case 21: //PHI
+		climate = parsePhilips(data, pos, c);
+		break;
+#if FREQ_BAND == 433
+	case 30: //PWM, KAKU row
+		kaku = ((PwmDecoder*) decoder)->getProtocol() == 0; //KAKU row
+		break;
+#endif
+	case 4: //FS20
+		if (parseFS20(data, pos, f))
+			printf(" hc:%04x adr:%02x cmd:%02x", f.house, f.addr, f.cmd);
+		break;
+	case 2: //EMX
+		if (parseEMx(data, pos, e))
+			printf(" em%d:%d seq:%d total:%d cur:%d peak:%d", e.type, e.addr,
+			e.seq, e.total, e.current, e.peak);
+		break;
+	}
+	if (climate) {
+		printf(" ch:%d id:%02x", c.channel, c.id);
+		printTemp(c.temp);
+		if (c.hum)
+			printf(" %d%%", c.hum);
+		if (c.lowBattery)
+			printf(" bat:low");
+	}
+	if (kaku && parseKaku(data, pos, s))
+		printf(" %c%d:%s", 'A' + s.house, s.unit, s.on ? "on" : "off");
+	else if (kaku && parseElro(data, pos, s))
+		printf(" elro %02x-%c:%s", s.house, 'A' + s.unit - 1, s.on ? "on" : "off");
+}
+#endif
+
 void printOOK(class DecodeOOK* decoder) {
 	uint8_t pos;
 	const uint8_t* data = decoder->getData(pos);
@@ -136,12 +197,15 @@ void printOOK(class DecodeOOK* decoder) {
 	//rf12_settings_text(textbuf);
 	//Serial.print(textbuf);
 	//Serial.print(' ');
-		printf("%s ", decoder->tag);
+		printf("%s ", decoder->packetTag());
 		//Serial.print(' ');
 		for (uint8_t i = 0; i < pos; ++i) {
 			printf("%02x", data[i]);
 		}
 		printRSSI();
+#if READINGS
+		printReading(decoder, data, pos);
+#endif
 		printf("\r\n");
 
 //    uint16_t j = rssi_bi;
@@ -154,6 +218,30 @@ void printOOK(class DecodeOOK* decoder) {
 	decoder->resetDecoder();
 }
 
+#if OOK_STATS
+void printDecoderStats() {
+	printf("decoder  pulses  accept  resets maxbits decodes  dups cycles/pulse\r\n");
+	for (uint8_t i = 0; decoders[i]; i++) {
+		const DecodeOOK::Stats& s = decoders[i]->getStats();
+		printf("%s %7d %7d %7d %7d %7d %5d %7d\r\n", decoders[i]->tag, s.pulses,
+				s.pulses - s.resets, s.resets, s.maxBits, s.decodes,
+				decoders[i]->getSuppressed(), s.pulses ? s.cycles / s.pulses : 0);
+		decoders[i]->clearStats();
+	}
+	for (uint8_t i = 0; decoders[i]; i++) {
+		const TimingCal* t = decoders[i]->getTiming();
+		if (!t)
+			continue;
+		printf("%s split:%d", decoders[i]->tag, t->getSplit());
+		for (uint8_t j = 0; j < t->getCount(); j++) {
+			const TimingCal::Sensor& e = t->getSensor(j);
+			printf(" id%d:%d/%d(%d)", e.id, e.shortWidth, e.longWidth, e.packets);
+		}
+		printf("\r\n");
+	}
+}
+#endif
+
 void processBit(uint16_t pulse_dur, uint8_t signal, uint8_t rssi) {
 	if (rssi) {
 		if (signal) {
@@ -164,8 +252,9 @@ void processBit(uint16_t pulse_dur, uint8_t signal, uint8_t rssi) {
 			rssi_buf[rssi_buf_i + 1] = rssi;
 		}
 	}
+	gate.add(pulse_dur, signal, rssi);
 	for (uint8_t i = 0; decoders[i]; i++) {
-		if (decoders[i]->nextPulse(pulse_dur, signal))
+		if (gate.pass(decoders[i], pulse_dur) && decoders[i]->nextPulse(pulse_dur, signal, rssi))
 			decoders[i]->decoded(decoders[i]);
 	}
 }
@@ -312,6 +401,10 @@ void receiveOOK() {
 			ts_rssi = sampleTicks;
 			if (rssi > rssimax)
 				rssimax = rssi;
+#if OOK_STATS
+			if (uart0RecvChar() == 's')
+				printDecoderStats();
+#endif
 		}
 
 		//Update minimum slice threshold (fixthd) every 10s
@@ -0,0 +1,228 @@
+//============================================================================
+// Name        : fifo-check.cpp
+// Description : Host check of RF69RC::sendookTrain() against a fake RF69
+//
+// The fake radio keeps the FIFO and drains a fixed number of bytes each time
+// the driver reads IRQFLAGS2 in transmit mode, the time the driver leaves
+// between FIFO level checks. Every train is checked for:
+//   - the bytes on air, exactly OFF, then (frame, gap OFF bytes) * repeats;
+//   - the FIFO never holding more than 66 bytes;
+//   - refill timing: the FIFO level when the driver refills, the least of
+//     which is the time left to respond, and no refill after it ran empty.
+// Frames of 1..66 bytes, 1..19 repeats and gaps of 0..5 bytes are sent at
+// drain rates up to FIFO_THRESH bytes per check, which must all pass, and
+// above it, where the trains that ran the FIFO empty are counted. Then random
+// batches of 2..16 frames go through the sendookTrain() of a frame list, as
+// OFF, then each frame followed by its own gap.
+// Build with -DRF69_SPI_BULK=1 for the burst writes. Exits with 1 on a
+// failure.
+//============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define chThdYield()
+#ifndef RF69_SPI_BULK
+#define RF69_SPI_BULK 0
+#endif
+
+enum { FIFO_SIZE = 66, FIFO_THRESH = 15 };
+
+// the radio side
+static struct {
+	uint8_t mode;
+	int fifo, maxFifo;      // bytes in the FIFO, most ever
+	int drain;              // bytes sent per IRQFLAGS2 read
+	bool polled;            // IRQFLAGS2 read since the last FIFO write
+	bool ranEmpty;          // the FIFO ran empty while transmitting
+	int underruns;          // bytes written after it ran empty
+	int minRefill, refills; // least FIFO level at a refill, refills
+	int bursts;             // SPI transactions writing the FIFO
+	std::vector<uint8_t> queue, air;
+} radio;
+
+static void fifoWrite(uint8_t b) {
+	if (radio.mode == 3 << 2 && radio.polled) {
+		if (radio.ranEmpty)
+			++radio.underruns;
+		if (radio.fifo < radio.minRefill)
+			radio.minRefill = radio.fifo;
+		++radio.refills;
+	}
+	radio.polled = false;
+	radio.queue.push_back(b);
+	if (++radio.fifo > radio.maxFifo)
+		radio.maxFifo = radio.fifo;
+}
+
+static uint8_t flags2() {
+	radio.polled = true;
+	if (radio.mode == 3 << 2) {
+		for (int i = 0; i < radio.drain && radio.fifo > 0; ++i) {
+			radio.air.push_back(radio.queue[radio.queue.size() - radio.fifo]);
+			--radio.fifo;
+		}
+		if (radio.fifo == 0)
+			radio.ranEmpty = true;
+	}
+	uint8_t f = 0;
+	if (radio.fifo > FIFO_THRESH)
+		f |= 1 << 5;  // FifoLevel
+	if (radio.fifo == 0 && radio.mode == 3 << 2)
+		f |= 1 << 3;  // PacketSent
+	return f;
+}
+
+class FakeSpi {
+public:
+	void enable() {
+		first = true;
+		data = 0;
+	}
+	uint8_t transfer(uint8_t b) {
+		if (first) {
+			first = false;
+			addr = b;
+			return 0;
+		}
+		uint8_t reg = addr & 0x7F;
+		if (!(addr & 0x80))
+			return reg == 0x28 ? flags2() : 0;
+		if (reg == 0x00) {
+			if (data++ == 0)
+				++radio.bursts;
+			fifoWrite(b);
+		} else if (reg == 0x01) {
+			radio.mode = b & 0x1C;
+		}
+		return 0;
+	}
+	void disable() {}
+private:
+	bool first;
+	uint8_t addr;
+	int data;
+};
+
+// the part of RF69 of the shared rf69.h that RF69RC uses
+template<typename SPI>
+class RF69 {
+public:
+	void init(uint8_t, uint8_t, int) {}
+	void setFrequency(uint32_t) {}
+	void configure(const uint8_t*) {}
+	void setMode(uint8_t mode) {
+		writeReg(0x01, mode);
+	}
+	uint8_t readReg(uint8_t addr) {
+		spi.enable();
+		spi.transfer(addr);
+		uint8_t v = spi.transfer(0);
+		spi.disable();
+		return v;
+	}
+	void writeReg(uint8_t addr, uint8_t value) {
+		spi.enable();
+		spi.transfer(addr | 0x80);
+		spi.transfer(value);
+		spi.disable();
+	}
+protected:
+	SPI spi;
+};
+
+#include "../rf69rc.h"
+
+static RF69RC<FakeSpi> rf;
+typedef RF69RC<FakeSpi>::OokFrame Frame;
+
+// send one train, a single frame repeated or a list of frames, false if it
+// failed a check the drain rate must pass
+static bool train(const Frame* frames, uint8_t count, uint8_t repeats,
+		int drain, bool& emptied) {
+	radio.mode = 1 << 2;
+	radio.fifo = radio.maxFifo = radio.underruns = radio.refills = radio.bursts = 0;
+	radio.minRefill = FIFO_SIZE;
+	radio.ranEmpty = radio.polled = false;
+	radio.drain = drain;
+	radio.queue.clear();
+	radio.air.clear();
+	if (count == 1)
+		rf.sendookTrain(frames[0].data, frames[0].len, repeats, frames[0].gap);
+	else
+		rf.sendookTrain(frames, count);
+
+	std::vector<uint8_t> want(1, 0);
+	for (uint8_t r = 0; r < repeats; ++r)
+		for (uint8_t i = 0; i < count; ++i) {
+			want.insert(want.end(), frames[i].data, frames[i].data + frames[i].len);
+			want.insert(want.end(), frames[i].gap, 0);
+		}
+	emptied = radio.underruns > 0;
+	const char* fail = NULL;
+	if (radio.maxFifo > FIFO_SIZE)
+		fail = "FIFO overflow";
+	else if (radio.air != want)
+		fail = "wrong bytes on air";
+	else if (radio.mode != 1 << 2)
+		fail = "not back in standby";
+	else if (drain <= FIFO_THRESH && emptied)
+		fail = "FIFO ran empty";
+	if (fail)
+		printf("%d frames, first %d bytes, %d repeats, gap %d, drain %d: %s\n",
+				count, frames[0].len, repeats, frames[0].gap, drain, fail);
+	return fail == NULL;
+}
+
+int main() {
+	uint8_t data[2 * FIFO_SIZE];
+	for (int i = 0; i < 2 * FIFO_SIZE; ++i)
+		data[i] = 1 + i;  // never an OFF byte
+
+	int bad = 0, n = 0, maxFifo = 0;
+	for (int drain = 1; drain <= FIFO_THRESH + 4; ++drain) {
+		int minRefill = FIFO_SIZE, refills = 0, bursts = 0, trains = 0, emptied = 0;
+		for (int len = 1; len <= FIFO_SIZE; ++len)
+			for (uint8_t repeats = 1; repeats < 20; ++repeats)
+				for (uint8_t gap = 0; gap <= 5; ++gap, ++n) {
+					Frame frame = { data, len, gap };
+					bool empty;
+					if (!train(&frame, 1, repeats, drain, empty) && bad++ > 10)
+						return 1;
+					if (radio.refills && radio.minRefill < minRefill)
+						minRefill = radio.minRefill;
+					if (radio.maxFifo > maxFifo)
+						maxFifo = radio.maxFifo;
+					refills += radio.refills;
+					bursts += radio.bursts;
+					trains += radio.refills > 0;
+					emptied += empty;
+				}
+		// at 5000 bps a byte takes 1.6 ms
+		printf("drain %2d: refill at %2d bytes left or more (%4.1f ms),"
+				" %6d refills in %6d FIFO writes, %4d of %4d refilled trains ran empty\n",
+				drain, minRefill, minRefill * 1.6, refills, bursts, emptied, trains);
+	}
+	printf("%d trains, RF69_SPI_BULK %d, at most %d bytes in the FIFO: %s\n", n,
+			RF69_SPI_BULK, maxFifo, bad ? "FAILED" : "ok");
+
+	Frame batch[16];
+	n = 0;
+	srand(1);
+	for (int drain = 1; drain <= FIFO_THRESH; ++drain)
+		for (int k = 0; k < 1000; ++k, ++n) {
+			uint8_t count = 2 + rand() % 15;
+			for (uint8_t i = 0; i < count; ++i) {
+				batch[i].data = data + rand() % FIFO_SIZE;
+				batch[i].len = 1 + rand() % FIFO_SIZE;
+				batch[i].gap = rand() % 9;
+			}
+			bool empty;
+			if (!train(batch, count, 1, drain, empty) && bad++ > 10)
+				return 1;
+		}
+	printf("%d batch trains of 2..16 frames: %s\n", n, bad ? "FAILED" : "ok");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,244 @@
+//============================================================================
+// Name        : ookimage-check.cpp
+// Description : Host check and benchmark of the ookimage.h encoders
+//
+// Compares the FIFO images of ookFS20() and ookKaku() bit for bit with the
+// addOutBit() encoders of rf-remote-control.cpp they replaced: FS20 over all
+// house codes and all address and command pairs of a few house codes, KAKU
+// over all address, device and on combinations. Checks that finish() fails
+// once bits were dropped from a full image, the hits and the replacement
+// order of OokImageCache, then times one FS20 frame with both.
+// Exits with 1 on a mismatch.
+//============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../ookimage.h"
+
+// the packet mode encoders of rf-remote-control.cpp before ookimage.h
+namespace ref {
+
+bool parity_even_bit(uint16_t v) {
+	bool parity = false;  // parity will be the parity of v
+
+	while (v) {
+		parity = !parity;
+		v = v & (v - 1);
+	}
+	return parity;
+}
+
+//Packet mode OOK transmit buffer
+uint8_t ookBuf[66];
+uint8_t k = 0;
+uint8_t l = 0;
+
+//Packet mode OOK add one packet-bit to transmit buffer
+void addOutBit(uint8_t v) {
+	if (k <= 65) {
+		ookBuf[k] |= (v & 1) << (7 - l);
+		if (++l == 8) {
+			l = 0;
+			k++;
+			if (k <= 65)
+				ookBuf[k] = 0;
+		}
+	}
+}
+
+void startOOK() {
+	k = 0;
+	l = 0;
+	ookBuf[0] = 0;
+}
+
+void stopOOK() {
+	//pad ookBuf with OFF (=0) to fill last byte.
+	while (l)
+		addOutBit(0);
+}
+
+static void fs20sendBits(uint16_t data, uint8_t bits) {
+	if (bits == 8) {
+		++bits;
+		data = (data << 1) | parity_even_bit(data);
+	}
+	for (uint16_t mask = 1 << (bits - 1); mask != 0; mask >>= 1) {
+		uint8_t n = (data & mask ? 3 : 2);
+		for (uint8_t on = n; on > 0; on--)
+			addOutBit(1);
+		for (uint8_t off = n; off > 0; off--)
+			addOutBit(0);
+	}
+}
+
+static void fs20cmd(uint16_t house, uint8_t addr, uint8_t cmd) {
+	uint8_t sum = 6 + (house >> 8) + house + addr + cmd;
+	startOOK();
+	fs20sendBits(1, 13);
+	fs20sendBits(house >> 8, 8);
+	fs20sendBits(house & 0xFF, 8);
+	fs20sendBits(addr, 8);
+	fs20sendBits(cmd, 8);
+	fs20sendBits(sum, 8);
+	fs20sendBits(0, 1);
+	stopOOK();
+}
+
+static void kakuSend(uint8_t addr, uint8_t device, uint8_t on) {
+	int cmd = 0x600 | ((device - 1) << 4) | ((addr - 1) & 0xF);
+	if (on)
+		cmd |= 0x800;
+	startOOK();
+	int sr = cmd;
+	for (uint8_t bit = 0; bit < 12; ++bit) {
+		addOutBit(1);
+		addOutBit(0);
+		addOutBit(0);
+		addOutBit(0);
+		uint8_t n = (sr & 1 ? 3 : 1);
+		for (uint8_t on = n; on > 0; on--)
+			addOutBit(1);
+		for (uint8_t off = 4-n; off > 0; off--)
+			addOutBit(0);
+		sr >>= 1;
+	}
+	addOutBit(1);
+	addOutBit(0);
+	stopOOK();
+}
+
+} // namespace ref
+
+static int bad;
+
+static void compare(const char* what, const OokImage& img, bool fit, unsigned a,
+		unsigned b, unsigned c) {
+	if (fit && img.len == ref::k && memcmp(img.data, ref::ookBuf, img.len) == 0)
+		return;
+	if (bad++ < 5)
+		printf("%s %u,%u,%u: %d bytes%s, addOutBit() %d bytes\n", what, a, b, c,
+				img.len, fit ? "" : " (did not fit)", ref::k);
+}
+
+static void checkFS20(OokImage& img, uint16_t house, uint8_t addr, uint8_t cmd) {
+	bool fit = ookFS20(img, house, addr, cmd);
+	ref::fs20cmd(house, addr, cmd);
+	compare("FS20", img, fit, house, addr, cmd);
+}
+
+static void checkOverflow() {
+	static OokImage img;
+	const char* fail = NULL;
+	img.clear();
+	for (int i = 0; i < OokImage::MAXBYTES; ++i)
+		img.put(0xA5, 8);
+	if (!img.finish())
+		fail = "a full image did not fit";
+	img.clear();
+	for (int i = 0; i < OokImage::MAXBYTES - 1; ++i)
+		img.put(0xA5, 8);
+	img.put(0x5, 3);
+	if (!img.finish() || img.len != OokImage::MAXBYTES || img.data[img.len - 1] != 0xA0)
+		fail = "padding the last byte did not fit";
+	img.clear();
+	for (int i = 0; i < OokImage::MAXBYTES; ++i)
+		img.put(0xA5, 8);
+	img.put(0x1, 1);
+	if (img.finish())
+		fail = "one bit more than a full image fit";
+	img.clear();
+	for (int i = 0; i < OokImage::MAXBYTES + 2; ++i)
+		img.put(0xA5, 8);
+	if (img.finish())
+		fail = "bytes dropped from a full image fit";
+	img.clear();
+	if (!img.finish() || img.len != 0)
+		fail = "clear() kept the overflow";
+	if (fail) {
+		printf("OokImage overflow: %s\n", fail);
+		bad++;
+	} else {
+		printf("OokImage overflow: ok\n");
+	}
+}
+
+static void checkCache() {
+	static OokImageCache cache;
+	bool hit;
+	const char* fail = NULL;
+	OokImage* first = &cache.lookup(OokImageCache::FS20, 1, hit);
+	if (hit)
+		fail = "hit in an empty cache";
+	for (uint32_t key = 2; key <= OOK_IMAGE_CACHE; ++key)
+		cache.lookup(OokImageCache::FS20, key, hit);
+	if (&cache.lookup(OokImageCache::FS20, 1, hit) != first || !hit)
+		fail = "no hit on a cached command";
+	else if (cache.lookup(OokImageCache::KAKU, 1, hit), hit)
+		fail = "hit on another kind with the same key";
+	// KAKU 1 took the slot of FS20 2, the one used longest ago
+	else if (cache.lookup(OokImageCache::FS20, 1, hit), !hit)
+		fail = "used command replaced";
+	else if (cache.lookup(OokImageCache::FS20, 2, hit), hit)
+		fail = "oldest command not replaced";
+	if (fail) {
+		printf("OokImageCache: %s\n", fail);
+		bad++;
+	} else {
+		printf("OokImageCache: ok\n");
+	}
+}
+
+static double nanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main() {
+	static OokImage img;
+	unsigned n = 0;
+
+	for (uint32_t house = 0; house < 0x10000; ++house, ++n)
+		checkFS20(img, house, house * 7, house * 13 >> 3);
+	static const uint16_t houses[] = { 0x0000, 0x1000, 0x1234, 0x5A5A, 0xA5A5,
+			0xFFFF };
+	for (uint8_t h = 0; h < sizeof houses / sizeof houses[0]; ++h)
+		for (uint32_t ac = 0; ac < 0x10000; ++ac, ++n)
+			checkFS20(img, houses[h], ac >> 8, ac);
+	printf("%u FS20 frames: %s\n", n, bad ? "MISMATCH" : "ok");
+
+	n = 0;
+	for (uint16_t addr = 0; addr < 256; ++addr)
+		for (uint16_t device = 0; device < 256; ++device)
+			for (uint8_t on = 0; on < 2; ++on, ++n) {
+				bool fit = ookKaku(img, addr, device, on);
+				ref::kakuSend(addr, device, on);
+				compare("KAKU", img, fit, addr, device, on);
+			}
+	printf("%u KAKU frames: %s\n", n, bad ? "MISMATCH" : "ok");
+
+	checkOverflow();
+	checkCache();
+
+	// best time of one frame over a number of rounds
+	const int calls = 10000;
+	double tRef = 1e30, tNew = 1e30;
+	for (int r = 0; r < 20; ++r) {
+		double t0 = nanos();
+		for (int i = 0; i < calls; ++i)
+			ref::fs20cmd(0x1234, i, 0x12);
+		double t1 = nanos();
+		for (int i = 0; i < calls; ++i)
+			ookFS20(img, 0x1234, i, 0x12);
+		double t2 = nanos();
+		if ((t1 - t0) / calls < tRef)
+			tRef = (t1 - t0) / calls;
+		if ((t2 - t1) / calls < tNew)
+			tNew = (t2 - t1) / calls;
+	}
+	printf("FS20 frame: addOutBit() %.0f ns, OokImage %.0f ns\n", tRef, tNew);
+	return bad ? 1 : 0;
+}
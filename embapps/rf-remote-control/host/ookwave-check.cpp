@@ -0,0 +1,121 @@
+//============================================================================
+// Name        : ookwave-check.cpp
+// Description : Host check of the ookwave.h continuous mode waveforms
+//
+// Builds FS20 and KAKU waveforms with ookWaveFS20() and ookWaveKaku() and
+// checks them twice:
+//   - the runs against the packet mode image of the same frame from
+//     ookimage.h, one image bit per 200 us (FS20) or 375 us (KAKU), the last
+//     off run holding the stop bit off time and the gap, where the image has
+//     the same off time and the padding of its last byte;
+//   - the edges of 1..3 repeats played by OokWave on OokWaveSim, the MRT at
+//     12 and 30 MHz with a fixed interrupt latency: the levels alternate,
+//     every edge after the first is late by exactly the latency and none is
+//     missing, so no error adds up along the train.
+// Exits with 1 on a failure.
+//============================================================================
+#include <stdio.h>
+#include <stdint.h>
+
+#define OOK_WAVE_SIM 1
+#include "../ookimage.h"
+#include "../ookwave.h"
+
+static int bad;
+
+// the edge the simulation is expected to report next
+static struct {
+	uint32_t edges;         // edges of the train, including the final off
+	int32_t late;           // ns every edge after the first is late
+	uint32_t seen;
+	bool wrong;
+} expect;
+
+static void report(uint32_t edge, bool on, int32_t ns) {
+	bool last = edge + 1 == expect.edges;
+	if (edge != expect.seen++ || edge >= expect.edges)
+		expect.wrong = true;
+	else if (on != (!last && edge % 2 == 0))
+		expect.wrong = true;
+	else if (ns != (edge == 0 ? 0 : expect.late))
+		expect.wrong = true;
+}
+
+// the runs of an image, 'period' us per bit
+static void imageRuns(const OokImage& img, uint16_t period, OokWaveRuns& r) {
+	r.clear();
+	for (uint8_t i = 0; i < img.len; ++i)
+		for (uint8_t mask = 0x80; mask != 0; mask >>= 1)
+			r.put(img.data[i] & mask, period);
+}
+
+static void check(const char* what, const OokWaveRuns& w, const OokImage& img,
+		bool fit, uint16_t period, uint16_t stop, uint16_t gap, unsigned a,
+		unsigned b, unsigned c) {
+	static OokWaveRuns ref;
+	const char* fail = NULL;
+	imageRuns(img, period, ref);
+	uint16_t n = w.count;
+	uint16_t tail = n > 0 ? w.runs[n - 1] & OokWaveRuns::MAXUS : 0;
+	uint16_t refTail = ref.count > 0 ? ref.runs[ref.count - 1] : 0;
+	if (!fit || n < 2 || n != ref.count)
+		fail = "run count";
+	else if (w.runs[n - 1] & OokWaveRuns::ON || refTail & OokWaveRuns::ON)
+		fail = "no trailing off run";
+	else if (tail != stop + gap || refTail < stop || refTail - stop >= 8 * period)
+		fail = "trailing off run";
+	for (uint16_t i = 0; !fail && i + 1 < n; ++i)
+		if (w.runs[i] != ref.runs[i])
+			fail = "runs differ from the image";
+
+	static const uint32_t clocks[] = { 12000000, 30000000 };
+	for (uint8_t k = 0; !fail && k < 2; ++k) {
+		uint32_t latency = clocks[k] / 1000000 * 3 / 2;  // 1.5 us
+		OokWaveSim sim(clocks[k], latency);
+		for (uint8_t repeats = 1; !fail && repeats <= 3; ++repeats) {
+			expect.edges = n * repeats + 1;
+			expect.late = (uint64_t) latency * 1000000000 / clocks[k];
+			expect.seen = 0;
+			expect.wrong = false;
+			int32_t worst = sim.run(w, repeats, report);
+			if (expect.wrong || expect.seen != expect.edges)
+				fail = "edges";
+			else if (worst != expect.late)
+				fail = "worst edge error";
+		}
+	}
+	if (fail && bad++ < 5)
+		printf("%s %u,%u,%u: %s\n", what, a, b, c, fail);
+}
+
+int main() {
+	static OokWaveRuns w;
+	static OokImage img;
+	unsigned n = 0;
+	int before = bad;
+
+	for (uint32_t house = 0; house < 0x10000; house += 7, ++n) {
+		uint8_t addr = house * 5, cmd = house * 13 >> 3;
+		ookWaveFS20(w, house, addr, cmd, 10000);
+		bool fit = ookFS20(img, house, addr, cmd);
+		check("FS20", w, img, fit, 200, 400, 10000, house, addr, cmd);
+	}
+	for (uint32_t ac = 0; ac < 0x10000; ac += 3, ++n) {
+		ookWaveFS20(w, 0x1234, ac >> 8, ac, 10000);
+		bool fit = ookFS20(img, 0x1234, ac >> 8, ac);
+		check("FS20", w, img, fit, 200, 400, 10000, 0x1234, ac >> 8, ac & 0xFF);
+	}
+	printf("%u FS20 waveforms: %s\n", n, bad > before ? "FAIL" : "ok");
+
+	n = 0;
+	before = bad;
+	for (uint16_t addr = 1; addr <= 16; ++addr)
+		for (uint16_t device = 1; device <= 16; ++device)
+			for (uint8_t on = 0; on < 2; ++on, ++n) {
+				ookWaveKaku(w, addr, device, on, 11000);
+				bool fit = ookKaku(img, addr, device, on);
+				check("KAKU", w, img, fit, 375, 375, 11000, addr, device, on);
+			}
+	printf("%u KAKU waveforms: %s\n", n, bad > before ? "FAIL" : "ok");
+	return bad ? 1 : 0;
+}
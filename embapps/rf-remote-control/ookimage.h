@@ -0,0 +1,144 @@
+/// @file
+/// Packed OOK waveform images for packet mode transmit.
+// In packet mode the RF69 sends the FIFO as the carrier on/off pattern, one
+// bit per bit period, MSB first. An image holds the FIFO bytes of a whole
+// frame. Each pulse pair is appended as one bit pattern through a 32 bit
+// register and stored a byte at a time, instead of a read-modify-write of the
+// buffer for every bit. Images of the last commands are kept in a small
+// cache, so repeats and repeated commands only need the FIFO burst write.
+
+#ifndef OOK_IMAGE_CACHE
+#define OOK_IMAGE_CACHE 4  // images kept, at least 1
+#endif
+
+class OokImage {
+  public:
+    enum { MAXBYTES = 66 };  // RF69 FIFO size
+    uint8_t data[MAXBYTES];
+    uint8_t len;             // bytes in data[]
+    bool overflow;           // bits were dropped, data[] was full
+
+    void clear () {
+      len = 0;
+      overflow = false;
+      acc = 0;
+      nacc = 0;
+    }
+
+    // append the low n bits of bits, MSB first, n <= 24
+    void put (uint32_t bits, uint8_t n) {
+      acc = (acc << n) | (bits & ((1UL << n) - 1));
+      nacc += n;
+      while (nacc >= 8) {
+        nacc -= 8;
+        if (len < MAXBYTES)
+          data[len++] = acc >> nacc;
+        else
+          overflow = true;
+      }
+    }
+
+    // pad the last byte with off bits, false if the frame did not fit
+    bool finish () {
+      if (nacc > 0)
+        put(0, 8 - nacc);
+      return !overflow;
+    }
+
+  private:
+    uint32_t acc;  // bits not yet stored in data[]
+    uint8_t nacc;  // number of bits in acc
+};
+
+inline uint8_t ookParity (uint8_t v) {
+  v ^= v >> 4;
+  v ^= v >> 2;
+  v ^= v >> 1;
+  return v & 1;
+}
+
+// FS20 bits at 5000 bps (200 us): 0 is 400 us on and 400 us off, 1 is 600 us
+// on and 600 us off. Bytes are followed by an even parity bit.
+inline void ookFS20Bits (OokImage& img, uint16_t data, uint8_t bits) {
+  if (bits == 8) {
+    ++bits;
+    data = (data << 1) | ookParity(data);
+  }
+  for (uint16_t mask = 1 << (bits - 1); mask != 0; mask >>= 1) {
+    if (data & mask)
+      img.put(0x38, 6);  // 111000
+    else
+      img.put(0x0C, 4);  // 1100
+  }
+}
+
+/// FS20 frame: 12 0-bits and a 1-bit of sync, house code, address, command
+/// and checksum, and a trailing 0-bit.
+inline bool ookFS20 (OokImage& img, uint16_t house, uint8_t addr, uint8_t cmd) {
+  uint8_t sum = 6 + (house >> 8) + house + addr + cmd;
+  img.clear();
+  ookFS20Bits(img, 1, 13);
+  ookFS20Bits(img, house >> 8, 8);
+  ookFS20Bits(img, house & 0xFF, 8);
+  ookFS20Bits(img, addr, 8);
+  ookFS20Bits(img, cmd, 8);
+  ookFS20Bits(img, sum, 8);
+  ookFS20Bits(img, 0, 1);
+  return img.finish();
+}
+
+/// KAKU frame at 2667 bps (375 us): 12 bits LSB first, each a 375 us pulse
+/// and 1125 us off, then 1125 us on and 375 us off for a 1 or 375 us on and
+/// 1125 us off for a 0, and a 375 us stop pulse.
+inline bool ookKaku (OokImage& img, uint8_t addr, uint8_t device, uint8_t on) {
+  uint16_t cmd = 0x600 | ((device - 1) << 4) | ((addr - 1) & 0xF);
+  if (on)
+    cmd |= 0x800;
+  img.clear();
+  for (uint8_t bit = 0; bit < 12; ++bit) {
+    img.put(cmd & 1 ? 0x8E : 0x88, 8);  // 1000 1110 or 1000 1000
+    cmd >>= 1;
+  }
+  img.put(0x2, 2);  // 10
+  return img.finish();
+}
+
+/// The images of the last commands sent, the one used longest ago is
+/// replaced first.
+class OokImageCache {
+  public:
+    enum { FS20 = 1, KAKU = 2 };
+
+    // the image of a command, 'hit' if it was built before, else a slot for
+    // the caller to build it in
+    OokImage& lookup (uint8_t kind, uint32_t key, bool& hit) {
+      uint8_t slot = 0;
+      for (uint8_t i = 0; i < OOK_IMAGE_CACHE; ++i) {
+        if (kinds[i] == kind && keys[i] == key) {
+          slot = i;
+          break;
+        }
+        if (age[i] > age[slot])
+          slot = i;
+      }
+      hit = kinds[slot] == kind && keys[slot] == key;
+      for (uint8_t i = 0; i < OOK_IMAGE_CACHE; ++i)
+        if (age[i] < 255)
+          ++age[i];
+      age[slot] = 0;
+      kinds[slot] = kind;
+      keys[slot] = key;
+      return image[slot];
+    }
+
+    // forget a command, e.g. when its image did not fit
+    void drop (OokImage& img) {
+      kinds[&img - image] = 0;
+    }
+
+  private:
+    OokImage image[OOK_IMAGE_CACHE];
+    uint32_t keys[OOK_IMAGE_CACHE];
+    uint8_t kinds[OOK_IMAGE_CACHE];  // 0: empty
+    uint8_t age[OOK_IMAGE_CACHE];    // commands sent since this one was used
+};
@@ -0,0 +1,60 @@
+/// @file
+/// Batches of remote control commands, sent in one transmit session.
+// Commands are collected first and then sent with the transmitter switched
+// on once for the whole batch. Their repeats are interleaved: the first frame
+// of every command goes out, then the second frame of every command that
+// repeats, and so on. Each frame is sent with the gap of its own protocol
+// after it, so every receiver still sees its silence between frames, and the
+// repeats of one command are spread over the batch instead of back to back.
+
+#ifndef OOK_QUEUE_SIZE
+#define OOK_QUEUE_SIZE 16  // commands in one batch
+#endif
+
+class OokQueue {
+  public:
+    OokQueue () : count (0), pos (0) {}
+
+    // add a command, false if the batch is full
+    bool add (uint8_t kind, uint32_t key, uint8_t repeats) {
+      if (count >= OOK_QUEUE_SIZE || repeats == 0)
+        return false;
+      kinds[count] = kind;
+      keys[count] = key;
+      left[count] = repeats;
+      ++count;
+      return true;
+    }
+
+    bool empty () const {
+      return count == 0;
+    }
+
+    bool full () const {
+      return count >= OOK_QUEUE_SIZE;
+    }
+
+    // the next frame to send, in interleaved order, false when all repeats
+    // are done and the batch is empty again
+    bool next (uint8_t& kind, uint32_t& key) {
+      for (uint8_t n = 0; n < count; ++n) {
+        if (pos >= count)
+          pos = 0;
+        uint8_t i = pos++;
+        if (left[i] > 0) {
+          --left[i];
+          kind = kinds[i];
+          key = keys[i];
+          return true;
+        }
+      }
+      count = pos = 0;
+      return false;
+    }
+
+  private:
+    uint32_t keys[OOK_QUEUE_SIZE];
+    uint8_t kinds[OOK_QUEUE_SIZE];
+    uint8_t left[OOK_QUEUE_SIZE];  // repeats not yet sent
+    uint8_t count, pos;            // pos: the command to look at next
+};
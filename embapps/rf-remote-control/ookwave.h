@@ -0,0 +1,221 @@
+/// @file
+/// Timer driven waveform playback for continuous mode OOK transmit.
+// In continuous mode the carrier follows the DATA pin. A waveform is a list
+// of runs, each a level and a duration in us, and is played from a timer
+// interrupt: every time the timer expires the pin is set to the level of the
+// next run, and the duration of the run after it is queued. The timer
+// reloads from the queued value by itself, so interrupt latency delays an
+// edge but does not add up along the train, and the main loop is free while
+// a train is sent. The timer backend supplies:
+//   uint32_t ticks (uint16_t us)  duration in timer ticks
+//   void level (bool on)          set the DATA pin
+//   void start (uint32_t ticks)   run the timer for ticks, then repeat
+//   void queue (uint32_t ticks)   interval to use after the current one
+//   void stop ()                  stop the timer
+
+#ifndef OOK_WAVE_RUNS
+#define OOK_WAVE_RUNS 128  // runs of one frame, FS20 needs 118
+#endif
+
+/// The runs of one frame, including the pause after it.
+class OokWaveRuns {
+  public:
+    enum { ON = 0x8000, MAXUS = 0x7FFF };
+    uint16_t runs[OOK_WAVE_RUNS];  // level in bit 15, duration in us
+    uint16_t count;
+
+    void clear () {
+      count = 0;
+    }
+
+    // append a run, a run of the same level as the last one extends it
+    void put (bool on, uint16_t us) {
+      uint16_t level = on ? ON : 0;
+      if (count > 0 && (runs[count - 1] & ON) == level
+          && (runs[count - 1] & MAXUS) + us <= MAXUS) {
+        runs[count - 1] += us;
+        return;
+      }
+      if (count < OOK_WAVE_RUNS)
+        runs[count++] = level | us;
+    }
+
+    void pulse (uint16_t on, uint16_t off) {
+      put(true, on);
+      put(false, off);
+    }
+};
+
+/// FS20 frame, see ookFS20(), followed by 'gap' us off.
+inline void ookWaveFS20 (OokWaveRuns& w, uint16_t house, uint8_t addr,
+                         uint8_t cmd, uint16_t gap) {
+  uint8_t bytes[6] = { 0, (uint8_t) (house >> 8), (uint8_t) house, addr, cmd };
+  bytes[5] = 6 + bytes[1] + bytes[2] + addr + cmd;
+  w.clear();
+  for (uint8_t i = 0; i < 12; ++i)
+    w.pulse(400, 400);
+  w.pulse(600, 600);
+  for (uint8_t i = 1; i < 6; ++i) {
+    uint16_t data = bytes[i] << 1;
+    uint8_t v = bytes[i];
+    v ^= v >> 4;
+    v ^= v >> 2;
+    v ^= v >> 1;
+    data |= v & 1;  // even parity
+    for (uint16_t mask = 1 << 8; mask != 0; mask >>= 1) {
+      uint16_t width = data & mask ? 600 : 400;
+      w.pulse(width, width);
+    }
+  }
+  w.pulse(400, 400 + gap);
+}
+
+/// KAKU frame, see ookKaku(), followed by 'gap' us off.
+inline void ookWaveKaku (OokWaveRuns& w, uint8_t addr, uint8_t device,
+                         uint8_t on, uint16_t gap) {
+  uint16_t cmd = 0x600 | ((device - 1) << 4) | ((addr - 1) & 0xF);
+  if (on)
+    cmd |= 0x800;
+  w.clear();
+  for (uint8_t bit = 0; bit < 12; ++bit) {
+    w.pulse(375, 1125);
+    uint16_t width = cmd & 1 ? 1125 : 375;
+    w.pulse(width, 1500 - width);
+    cmd >>= 1;
+  }
+  w.pulse(375, 375 + gap);
+}
+
+/// Plays a list of runs a number of times, from the timer interrupt.
+template< typename TIMER >
+class OokWave {
+  public:
+    TIMER timer;
+
+    OokWave () : left (0) {}
+
+    // start sending, false if a train is still being sent
+    bool play (const OokWaveRuns& w, uint8_t repeats) {
+      if (busy() || w.count == 0 || repeats == 0)
+        return false;
+      runs = w.runs;
+      count = w.count;
+      left = repeats;
+      pos = 0;
+      timer.level(runs[0] & OokWaveRuns::ON);
+      timer.start(timer.ticks(runs[0] & OokWaveRuns::MAXUS));
+      next();
+      return true;
+    }
+
+    bool busy () const {
+      return left != 0;
+    }
+
+    // call from the timer interrupt: the queued run has started
+    void expired () {
+      if (pos >= count) {
+        timer.level(false);
+        timer.stop();
+        left = 0;
+        return;
+      }
+      timer.level(runs[pos] & OokWaveRuns::ON);
+      next();
+    }
+
+  private:
+    const uint16_t* runs;
+    uint16_t count, pos;       // pos: the run queued to go next
+    volatile uint8_t left;     // repeats not yet finished
+
+    // queue the run after the current one, after the last run of the last
+    // repeat pos is left at count and the expiry ends the train
+    void next () {
+      if (++pos >= count) {
+        if (left == 1)
+          return;
+        --left;
+        pos = 0;
+      }
+      timer.queue(timer.ticks(runs[pos] & OokWaveRuns::MAXUS));
+    }
+};
+
+#if OOK_WAVE_SIM
+/// Host timer backend: runs a waveform on a simulated clock of 'hz', with the
+/// pin changing 'latency' ticks after each expiry, and reports for every edge
+/// how far it is off from the sum of the run durations before it, in ns.
+class OokWaveSim {
+  public:
+    typedef void (*Report) (uint32_t edge, bool on, int32_t ns);
+
+    struct Timer {
+      OokWaveSim* sim;
+
+      uint32_t ticks (uint16_t us) {
+        return (uint64_t) us * sim->hz / 1000000;
+      }
+      void level (bool on) {
+        sim->edge(on);
+      }
+      void start (uint32_t t) {
+        sim->expiry = sim->now + t;
+        sim->reload = t;
+        sim->running = true;
+      }
+      void queue (uint32_t t) {
+        sim->reload = t;
+      }
+      void stop () {
+        sim->running = false;
+      }
+    };
+
+    OokWaveSim (uint32_t clock, uint32_t delay) : hz (clock), latency (delay) {
+      wave.timer.sim = this;
+    }
+
+    // send w 'repeats' times, returns the largest error in ns
+    int32_t run (const OokWaveRuns& w, uint8_t repeats, Report report) {
+      now = 0;
+      edges = 0;
+      worst = 0;
+      list = &w;
+      callback = report;
+      if (!wave.play(w, repeats))
+        return -1;
+      while (running) {
+        now = expiry + latency;
+        expiry += reload;
+        wave.expired();
+      }
+      return worst;
+    }
+
+  private:
+    OokWave<Timer> wave;
+    uint32_t hz, latency;
+    uint64_t now, expiry;
+    uint32_t reload;
+    bool running;
+    const OokWaveRuns* list;
+    uint32_t edges;
+    uint64_t ideal;  // us
+    int32_t worst;
+    Report callback;
+
+    void edge (bool on) {
+      if (edges == 0)
+        ideal = 0;
+      else
+        ideal += list->runs[(edges - 1) % list->count] & OokWaveRuns::MAXUS;
+      int32_t ns = (int64_t) (now * 1000000000 / hz) - (int64_t) ideal * 1000;
+      if ((ns < 0 ? -ns : ns) > worst)
+        worst = ns < 0 ? -ns : ns;
+      if (callback)
+        callback(edges, on, ns);
+      ++edges;
+    }
+};
+#endif
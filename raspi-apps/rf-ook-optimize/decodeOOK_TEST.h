@@ -1,19 +1,190 @@
 /// @file
 /// Generalized decoder framework for 868 MHz and 433 MHz OOK signals.
 
+#include "crc.h"
+#include "bitbuffer.h"
+
+// time base for duplicate packet detection, in tenths of seconds
+#ifndef OOK_TENTHS
+#define OOK_TENTHS() (millis() / 100)
+#endif
+
+// number of distinct recent packets remembered per decoder
+#ifndef OOK_REPEAT_SLOTS
+#define OOK_REPEAT_SLOTS 4
+#endif
+
+// soft decisions: number of weakest bits remembered per packet, and the
+// confidence below which repair() may flip them, 64 = 100% off threshold
+#ifndef OOK_SOFT_BITS
+#define OOK_SOFT_BITS 3
+#endif
+#ifndef OOK_SOFT_WEAK
+#define OOK_SOFT_WEAK 16
+#endif
+
+// pulses kept by PreambleGate for replay, a power of 2
+#ifndef OOK_GATE_HISTORY
+#define OOK_GATE_HISTORY 32
+#endif
+
+// sensors remembered by TimingCal, 0 disables learning
+#ifndef OOK_CAL_SENSORS
+#define OOK_CAL_SENSORS 4
+#endif
+
+// per decoder counters and decode() timing, see DecodeOOK::Stats
+#ifndef OOK_STATS
+#define OOK_STATS 0
+#endif
+
+#if OOK_STATS && !defined(OOK_CYCLES)
+#if defined(__linux__)
+#include <time.h>
+static uint32_t ookNanos () {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+#define OOK_CYCLES() ookNanos()
+#elif defined(DWT)
+#define OOK_CYCLES() (DWT->CYCCNT) // Cortex-M3 and up, needs DWT->CTRL |= 1
+#else
+#define OOK_CYCLES() micros()
+#endif
+#endif
 
 static uint16_t long1width = 500;
 static uint16_t long0width = 500;
 
+/// Learns the actual short and long pulse widths of individual sensors, so the
+/// split point between them can follow the sensors that are really in range
+/// instead of the nominal timing. The widths of the current packet are summed
+/// with add(), and folded into a running average for the sensor that sent it
+/// with learn(), once the packet is known to be good. The split point is kept
+/// halfway between the longest short and the shortest long width of all known
+/// sensors, clamped to [min, max].
+class TimingCal {
+  public:
+    struct Sensor {
+      uint16_t id;
+      uint16_t shortWidth, longWidth; // running averages, in us
+      uint16_t packets;
+      uint8_t age;                    // packets from other sensors since
+    };
+
+    TimingCal (uint16_t thd, uint16_t min, uint16_t max)
+      : split(thd), minSplit(min), maxSplit(max), count(0) {
+      reset();
+    }
+
+    // forget the widths of the current packet
+    void reset () {
+      sumShort = sumLong = 0;
+      numShort = numLong = 0;
+    }
+
+    void add (uint16_t width, bool isLong) {
+      if (isLong) {
+        sumLong += width;
+        numLong++;
+      } else {
+        sumShort += width;
+        numShort++;
+      }
+    }
+
+    // the current packet was valid and came from sensor id
+    void learn (uint16_t id) {
+      if (OOK_CAL_SENSORS == 0 || numShort == 0 || numLong == 0)
+        return;
+      uint16_t s = sumShort / numShort, l = sumLong / numLong;
+      // find the sensor, or else replace the one not heard for the longest
+      uint8_t slot = 0;
+      bool fresh = true;
+      for (uint8_t i = 0; i < count; ++i) {
+        if (sensors[i].id == id) {
+          slot = i;
+          fresh = false;
+          break;
+        }
+      }
+      if (fresh) {
+        if (count < OOK_CAL_SENSORS)
+          slot = count++;
+        else
+          for (uint8_t i = 1; i < count; ++i)
+            if (sensors[i].age > sensors[slot].age)
+              slot = i;
+      }
+      for (uint8_t i = 0; i < count; ++i)
+        if (sensors[i].age < 255)
+          sensors[i].age++;
+      Sensor& e = sensors[slot];
+      if (fresh) {
+        e.id = id;
+        e.shortWidth = s;
+        e.longWidth = l;
+        e.packets = 0;
+      } else {
+        e.shortWidth += ((int16_t) s - (int16_t) e.shortWidth) / 8;
+        e.longWidth += ((int16_t) l - (int16_t) e.longWidth) / 8;
+      }
+      e.age = 0;
+      if (e.packets < 0xFFFF)
+        e.packets++;
+      // halfway between the widest short and the narrowest long
+      uint16_t maxShort = 0, minLong = 0xFFFF;
+      for (uint8_t i = 0; i < count; ++i) {
+        if (sensors[i].shortWidth > maxShort)
+          maxShort = sensors[i].shortWidth;
+        if (sensors[i].longWidth < minLong)
+          minLong = sensors[i].longWidth;
+      }
+      uint16_t thd = ((uint32_t) maxShort + minLong) / 2;
+      split = thd < minSplit ? minSplit : thd > maxSplit ? maxSplit : thd;
+    }
+
+    // width at which a pulse counts as long
+    uint16_t getSplit () const {
+      return split;
+    }
+
+    // learned sensors, 0 <= i < getCount()
+    uint8_t getCount () const {
+      return count;
+    }
+
+    const Sensor& getSensor (uint8_t i) const {
+      return sensors[i];
+    }
+
+  private:
+    uint16_t split, minSplit, maxSplit;
+    uint32_t sumShort, sumLong;
+    uint8_t numShort, numLong, count;
+    Sensor sensors[OOK_CAL_SENSORS > 0 ? OOK_CAL_SENSORS : 1];
+};
+
 /// This is the general base class for implementing OOK decoders.
-class DecodeOOK {
+class DecodeOOK : protected BitBuffer {
   protected:
-    uint8_t total_bits, bits, flip, state, pos, data[25];
+    uint8_t flip, state;
     // the following fields are used to deal with duplicate packets
-    uint16_t lastCrc, lastTime;
-    uint8_t repeats, minGap, minCount;
-    uint8_t last_signal;
+    struct RepeatSlot {
+      uint16_t crc, time;
+      uint8_t repeats;
+    } seen[OOK_REPEAT_SLOTS];
+    uint16_t suppressed, repaired;
+    uint8_t minGap, minCount;
+    uint8_t last_signal, last_rssi;
+    // weakest bits of the current packet, see softBit()
+    uint8_t weakPos[OOK_SOFT_BITS], weakConf[OOK_SOFT_BITS], weakCount;
     uint16_t last_width;
+    // preamble gate, see setPreamble()
+    uint16_t wakeMin, wakeMax;
+    uint8_t wakeRun, run;
+    bool parked;
 
     //for logging pulse lengths
 #define max_pulse_cnt 150
@@ -29,78 +200,121 @@ class DecodeOOK {
 
     // add one bit to the packet data buffer
     virtual void gotBit (int8_t value) {
-      total_bits++;
-      uint8_t *ptr = data + pos;
-      *ptr = (*ptr >> 1) | (value << 7);
-
-      if (++bits >= 8) {
-        bits = 0;
-        if (++pos >= sizeof data) {
-          resetDecoder();
-          return;
-        }
+      if (!put(value)) {
+        resetDecoder();
+        return;
       }
       state = OK;
     }
 
-    // store a bit using Manchester encoding
-    void manchester (int8_t value) {
-      flip ^= value; // manchester code, long pulse flips the bit
-      gotBit(flip);
+    // Confidence of a bit that was decided by comparing width to thd: the
+    // distance to the threshold, 64 = 100%. It is scaled by the RSSI of the
+    // pulse when known, 64 (around -95 dBm) counts as neutral.
+    uint8_t confidence (uint16_t width, uint16_t thd) const {
+      uint32_t c = (uint32_t) (width > thd ? width - thd : thd - width) * 64 / thd;
+      if (last_rssi)
+        c = c * last_rssi / 64;
+      return c > 255 ? 255 : c;
     }
 
-    // move bits to the front so that all the bits are aligned to the end
-    void alignTail (uint8_t max = 0) {
-      // align bits
-      if (bits != 0) {
-        data[pos] >>= 8 - bits;
-        for (uint8_t i = 0; i < pos; ++i)
-          data[i] = (data[i] >> bits) | (data[i + 1] << (8 - bits));
-        bits = 0;
-      }
-      // optionally shift uint8_ts down if there are too many of 'em
-      if (max > 0 && pos > max) {
-        uint8_t n = pos - max;
-        pos = max;
-        for (uint8_t i = 0; i < pos; ++i)
-          data[i] = data[i + n];
+    // add a bit with its confidence, the weakest ones are kept for repair()
+    void softBit (int8_t value, uint8_t conf) {
+      uint8_t n = total_bits;
+      gotBit(value);
+      if (total_bits != n + 1)
+        return;
+      if (conf < OOK_SOFT_WEAK && weakCount < 255)
+        weakCount++;
+      uint8_t j = 0;
+      for (uint8_t i = 1; i < OOK_SOFT_BITS; ++i)
+        if (weakConf[i] > weakConf[j])
+          j = i;
+      if (conf < weakConf[j]) {
+        weakConf[j] = conf;
+        weakPos[j] = n;
       }
     }
 
-    void reverseBits () {
-      for (uint8_t i = 0; i < pos; ++i) {
-        uint8_t b = data[i];
-        for (uint8_t j = 0; j < 8; ++j) {
-          data[i] = (data[i] << 1) | (b & 1);
-          b >>= 1;
+    // packet check for repair(), decoders with a CRC override this
+    virtual bool validate () {
+      return false;
+    }
+
+    // Try to fix a packet that fails validate() by inverting its weakest bits,
+    // first one at a time, then in pairs. Only bits with a confidence below
+    // OOK_SOFT_WEAK are tried, and only if there are no more of those than
+    // are remembered, to keep the odds of turning noise into a valid looking
+    // packet low.
+    bool repair () {
+      if (weakCount > OOK_SOFT_BITS)
+        return false;
+      uint8_t weak[OOK_SOFT_BITS], n = 0;
+      for (uint8_t i = 0; i < OOK_SOFT_BITS; ++i)
+        if (weakConf[i] < OOK_SOFT_WEAK && weakPos[i] < total_bits)
+          weak[n++] = weakPos[i];
+      for (uint8_t i = 0; i < n; ++i) {
+        flipBit(weak[i]);
+        if (validate()) {
+          repaired++;
+          return true;
+        }
+        flipBit(weak[i]);
+      }
+      for (uint8_t i = 0; i < n; ++i) {
+        flipBit(weak[i]);
+        for (uint8_t j = i + 1; j < n; ++j) {
+          flipBit(weak[j]);
+          if (validate()) {
+            repaired++;
+            return true;
+          }
+          flipBit(weak[j]);
         }
+        flipBit(weak[i]);
       }
+      return false;
     }
 
-    void reverseNibbles () {
-      for (uint8_t i = 0; i < pos; ++i)
-        data[i] = (data[i] << 4) | (data[i] >> 4);
+    // store a bit using Manchester encoding
+    void manchester (int8_t value) {
+      flip ^= value; // manchester code, long pulse flips the bit
+      gotBit(flip);
     }
 
-    //  bool checkRepeats () {
-    //    // calculate the checksum over the current packet
-    //    uint16_t crc = ~0;
-    //    for (uint8_t i = 0; i < pos; ++i)
-    //    crc = _crc16_update(crc, data[i]);
-    //    // how long was it since the last decoded packet
-    //    uint16_t now = millis() / 100; // tenths of seconds
-    //    uint16_t since = now - lastTime;
-    //    // if different crc or too long ago, this cannot be a repeated packet
-    //    if (crc != lastCrc || since > minGap)
-    //    repeats = 0;
-    //    // save last values and decide whether to report this as a new packet
-    //    lastCrc = crc;
-    //    lastTime = now;
-    //    return repeats++ == minCount;
-    //  }
-
+    // Report a packet only once per burst of repeats. A small cache of recent
+    // payload hashes is kept, so interleaved senders on the same decoder are
+    // each deduplicated. A repeat is a packet with the same hash seen less than
+    // minGap tenths of a second after the previous copy. The minCount+1'th copy
+    // is reported, all other copies are counted as suppressed.
     bool checkRepeats () {
-      return 1;
+      // calculate the checksum over the current packet
+      uint16_t crc = Crc16::block(~0, data, pos) ^ total_bits;
+      uint16_t now = OOK_TENTHS();
+      // find the matching entry, or else the least recently used one
+      uint8_t slot = 0;
+      for (uint8_t i = 0; i < OOK_REPEAT_SLOTS; ++i) {
+        if (seen[i].crc == crc && seen[i].repeats) {
+          slot = i;
+          break;
+        }
+        if ((uint16_t)(now - seen[i].time) > (uint16_t)(now - seen[slot].time))
+          slot = i;
+      }
+      RepeatSlot& r = seen[slot];
+      // how long was it since the last decoded packet
+      uint16_t since = now - r.time;
+      // if different crc or too long ago, this cannot be a repeated packet
+      if (r.crc != crc || since > minGap)
+        r.repeats = 0;
+      // save last values and decide whether to report this as a new packet
+      r.crc = crc;
+      r.time = now;
+      if (r.repeats < 255)
+        r.repeats++;
+      if (r.repeats == minCount + 1)
+        return 1;
+      suppressed++;
+      return 0;
     }
 
     void print_stats () {
@@ -153,6 +367,51 @@ class DecodeOOK {
       return;
     }
 
+    // act on the return value of decode(), see nextPulse()
+    void nextResult (int8_t result) {
+      switch (result) {
+        case -1: // decoding failed
+#if OOK_STATS
+          stats.resets++;
+          if (total_bits > stats.maxBits)
+            stats.maxBits = total_bits;
+#endif
+          resetDecoder();
+          break;
+        case 1: // decoding finished
+#if OOK_STATS
+          stats.decodes++;
+#endif
+          while (bits)
+            gotBit(0); // padding
+          flush();
+          if (checkRepeats()) {
+            state = DONE;
+          } else {
+            resetDecoder(); // duplicate, drop it
+            break;
+          }
+
+          //print stats
+          //print_stats();
+
+          //dump pulse buffers
+          for (int i=0; i<pulse_cnt; i++) {
+              //chprintf(serial, "%d,", pulseON[i]);
+             printf("%d,", pulseON[i]);
+          }
+          //chprintf(serial, "\r\n");
+          printf("\r\n");
+          for (int i=0; i<pulse_cnt; i++) {
+              //chprintf(serial, "%d,", pulseOFF[i]);
+             printf("%d,", pulseOFF[i]);
+          }
+          //chprintf(serial, "\r\n");
+          printf("\r\n");
+          break;
+      }
+    }
+
   private:
     char es;
 
@@ -165,46 +424,36 @@ class DecodeOOK {
     decoded_cb decoded;
 
     DecodeOOK (uint8_t gap = 5, uint8_t count = 0)
-      : es(0), id(0), tag(&es), decoded(NULL), lastCrc (0), lastTime (0), repeats (0), minGap (gap), minCount (count)
+      : es(0), id(0), tag(&es), decoded(NULL), suppressed (0), repaired (0), minGap (gap), minCount (count), wakeRun (0)
     {
+      clearRepeats();
       resetDecoder();
+#if OOK_STATS
+      clearStats();
+#endif
     }
 
     DecodeOOK (uint8_t nid, const char* ntag, decoded_cb cb, uint8_t gap = 5, uint8_t count = 0)
-      : es(0), lastCrc (0), lastTime (0), repeats (0), minGap (gap), minCount (count), id (nid), tag (ntag), decoded (cb)
+      : es(0), suppressed (0), repaired (0), minGap (gap), minCount (count), id (nid), tag (ntag), decoded (cb), wakeRun (0)
     {
+      clearRepeats();
       resetDecoder();
+#if OOK_STATS
+      clearStats();
+#endif
     }
 
     virtual bool nextPulse (uint16_t width) {
-      if (state != DONE)
-        switch (decode(width)) {
-          case -1: // decoding failed
-            resetDecoder();
-            break;
-          case 1: // decoding finished
-            while (bits)
-              gotBit(0); // padding
-            state = checkRepeats() ? DONE : UNKNOWN;
-
-            //print stats
-            //print_stats();
-
-            //dump pulse buffers
-            for (int i=0; i<pulse_cnt; i++) {
-                //chprintf(serial, "%d,", pulseON[i]);
-               printf("%d,", pulseON[i]);
-            }
-            //chprintf(serial, "\r\n");
-            printf("\r\n");
-            for (int i=0; i<pulse_cnt; i++) {
-                //chprintf(serial, "%d,", pulseOFF[i]);
-               printf("%d,", pulseOFF[i]);
-            }
-            //chprintf(serial, "\r\n");
-            printf("\r\n");
-            break;
-        }
+      if (state != DONE) {
+#if OOK_STATS
+        uint32_t start = OOK_CYCLES();
+        stats.pulses++;
+#endif
+        nextResult(decode(width));
+#if OOK_STATS
+        stats.cycles += OOK_CYCLES() - start;
+#endif
+      }
       return state == DONE;
     }
 
@@ -234,17 +483,143 @@ class DecodeOOK {
       return DecodeOOK::nextPulse(width);
     }
 
+    // as above, with the RSSI of the pulse for soft decisions, 0 = unknown
+    bool nextPulse (uint16_t width, uint8_t signal, uint8_t rssi) {
+      last_rssi = rssi;
+      return nextPulse(width, signal);
+    }
+
     const uint8_t* getData (uint8_t& count) const {
       count = pos;
       return data;
     }
 
+    // tag of the last packet, a decoder for several protocols names the one
+    // that matched instead of itself
+    virtual const char* packetTag () const {
+      return tag;
+    }
+
+    // number of duplicate packets that were not reported
+    uint16_t getSuppressed () const {
+      return suppressed;
+    }
+
+    // number of packets fixed by repair()
+    uint16_t getRepaired () const {
+      return repaired;
+    }
+
+    // learned timing of decoders that calibrate themselves, else NULL
+    virtual const TimingCal* getTiming () const {
+      return NULL;
+    }
+
+#if OOK_STATS
+    // counters since the last clearStats(), accepted pulses = pulses - resets
+    struct Stats {
+      uint32_t pulses, resets, decodes;
+      uint32_t cycles; // time spent in decode(), in OOK_CYCLES() units
+      uint8_t maxBits; // longest bit count seen before a reset
+    };
+
+    const Stats& getStats () const {
+      return stats;
+    }
+
+    void clearStats () {
+      stats = Stats();
+    }
+
+  private:
+    Stats stats;
+
+  public:
+#endif
+    // Let PreambleGate park the decoder between packets, until count pulses in
+    // a row with min <= width < max came in. The range must hold every width
+    // that does not reset the decoder while it waits for its preamble, and
+    // count must be less than the preamble length. count = 0 disables it.
+    void setPreamble (uint16_t min, uint16_t max, uint8_t count) {
+      wakeMin = min;
+      wakeMax = max;
+      wakeRun = count < OOK_GATE_HISTORY ? count : OOK_GATE_HISTORY;
+      run = 0;
+      parked = wakeRun != 0;
+    }
+
+    bool isParked () const {
+      return parked;
+    }
+
+    // count a pulse while parked, returns the run length once it wakes up
+    uint8_t preamblePulse (uint16_t width) {
+      if (width < wakeMin || width >= wakeMax) {
+        run = 0;
+        return 0;
+      }
+      if (++run < wakeRun)
+        return 0;
+      parked = false;
+      return run;
+    }
+
+    // forget recently seen packets, e.g. after retuning the receiver
+    void clearRepeats () {
+      for (uint8_t i = 0; i < OOK_REPEAT_SLOTS; ++i)
+        seen[i].crc = seen[i].time = seen[i].repeats = 0;
+    }
+
     virtual void resetDecoder ()
     {
-      total_bits = bits = pos = flip = 0;
+      clear();
+      flip = 0;
       state = UNKNOWN;
+      run = 0;
+      parked = wakeRun != 0;
+      for (uint8_t i = 0; i < OOK_SOFT_BITS; ++i)
+        weakConf[i] = 255;
+      weakCount = 0;
 
       pulse_cnt = 0;
     }
 };
 
+/// Cheap shared pre-stage in front of the decoders. In noise most edges only
+/// reset every decoder, so decoders with a preamble (see setPreamble()) are
+/// parked between packets and skipped. When a matching run of pulses shows
+/// up, the run is replayed into the decoder, which then ends up in the same
+/// state as if it had seen every pulse.
+class PreambleGate {
+    uint16_t widths[OOK_GATE_HISTORY];
+    uint8_t signals[OOK_GATE_HISTORY];
+    uint8_t rssis[OOK_GATE_HISTORY];  // for the soft bits of a replay
+    uint8_t head;
+
+  public:
+    PreambleGate () : head(0) {}
+
+    // remember a pulse, call this once per pulse before pass()
+    void add (uint16_t width, uint8_t signal, uint8_t rssi = 0) {
+      widths[head] = width;
+      signals[head] = signal;
+      rssis[head] = rssi;
+      head = (head + 1) & (OOK_GATE_HISTORY - 1);
+    }
+
+    // returns true if the last added pulse must be fed to this decoder
+    bool pass (DecodeOOK* decoder, uint16_t width) {
+      if (!decoder->isParked())
+        return true;
+      uint8_t n = decoder->preamblePulse(width);
+      if (n == 0)
+        return false;
+      // woken up: replay the run up to, but not including, this pulse
+      for (uint8_t i = head - n; --n > 0; ++i) {
+        uint8_t j = i & (OOK_GATE_HISTORY - 1);
+        if (decoder->nextPulse(widths[j], signals[j], rssis[j]))
+          decoder->decoded(decoder);
+      }
+      return true;
+    }
+};
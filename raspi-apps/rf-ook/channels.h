@@ -0,0 +1,174 @@
+/// @file
+/// Time sliced receive on several channels with one radio.
+// A channel is a frequency, receiver bandwidth and OOK threshold, with the
+// decoders of the sensors that send there. begin() tunes to every channel
+// once and keeps its register image, so a hop only writes the registers that
+// differ from the image of the channel before it: no frequency arithmetic, no
+// AFC readback and no printing while receiving.
+// Each channel gets at least minDwell ms per round. The time up to maxDwell
+// is shared out by the packets decoded on each channel in recent rounds, so
+// busy channels get longer slices and quiet ones are still visited. After a
+// decode the radio stays OOK_CHANNEL_LINGER ms longer for the repeats, and a
+// hop waits while a decoder is in the middle of a packet, but no longer than
+// OOK_CHANNEL_HOLD ms past maxDwell.
+
+#ifndef OOK_CHANNELS
+#define OOK_CHANNELS 4          // channels in a plan
+#endif
+#ifndef OOK_CHANNEL_LINGER
+#define OOK_CHANNEL_LINGER 300  // ms to stay after a decode
+#endif
+#ifndef OOK_CHANNEL_HOLD
+#define OOK_CHANNEL_HOLD 200    // ms a hop can wait for a packet
+#endif
+
+template< typename RADIO >
+class ChannelPlan {
+  public:
+    struct Channel {
+      uint32_t frqkHz;
+      uint8_t bw, thd;
+      DecodeOOK** decoders;          // NULL terminated
+      uint16_t minDwell, maxDwell;   // ms
+      uint16_t dwell;                // ms in this round, learned
+      uint16_t score;                // recent decodes, decays every round
+      uint16_t hops, decodes;        // since clearStats()
+      uint8_t image[RADIO::CONTEXT_SIZE];
+    };
+
+    uint8_t hopRegs;  // registers written by the last hop
+    uint32_t hopUs;   // duration of the last hop
+
+    ChannelPlan (RADIO& radio)
+      : hopRegs (0), hopUs (0), rf (radio), count (0), cur (0) {}
+
+    // add a channel, false if the plan is full
+    bool add (uint32_t frqkHz, uint8_t bw, uint8_t thd, DecodeOOK** decoders,
+              uint16_t minDwell, uint16_t maxDwell) {
+      if (count >= OOK_CHANNELS)
+        return false;
+      Channel& c = ch[count++];
+      c.frqkHz = frqkHz;
+      c.bw = bw;
+      c.thd = thd;
+      c.decoders = decoders;
+      c.minDwell = minDwell;
+      c.maxDwell = maxDwell > minDwell ? maxDwell : minDwell;
+      c.dwell = minDwell;
+      c.score = 0;
+      c.hops = c.decodes = 0;
+      return true;
+    }
+
+    // read the image of every channel, the last one read is the first
+    // channel, which the radio then receives on
+    void begin (uint32_t now) {
+      for (uint8_t i = count; i-- > 0; ) {
+        rf.setFrequency(ch[i].frqkHz);
+        rf.setBW(ch[i].bw);
+        rf.setThd(ch[i].thd);
+        rf.saveContext(ch[i].image);
+      }
+      cur = 0;
+      start = now;
+      deadline = now + ch[0].dwell;
+    }
+
+    uint8_t size () const {
+      return count;
+    }
+
+    const Channel& channel (uint8_t i) const {
+      return ch[i];
+    }
+
+    const Channel& current () const {
+      return ch[cur];
+    }
+
+    DecodeOOK** decoders () const {
+      return ch[cur].decoders;
+    }
+
+    // a packet was decoded on the current channel
+    void decoded (uint32_t now) {
+      Channel& c = ch[cur];
+      ++c.decodes;
+      if (c.score < 0xFFFF - 16)
+        c.score += 16;
+      uint32_t until = now + OOK_CHANNEL_LINGER;
+      if ((int32_t) (until - (start + c.maxDwell)) > 0)
+        until = start + c.maxDwell;
+      if ((int32_t) (until - deadline) > 0)
+        deadline = until;
+    }
+
+    // new threshold for the current channel, also kept in its image
+    void setThd (uint8_t thd) {
+      ch[cur].thd = thd;
+      rf.setThd(thd);
+      rf.saveContext(ch[cur].image);
+    }
+
+    // call often with millis(), true when the radio hopped to the next
+    // channel, the decoders of the previous one have been reset then
+    bool poll (uint32_t now) {
+      if (count < 2 || (int32_t) (now - deadline) < 0)
+        return false;
+      if (busy() && now - start < (uint32_t) ch[cur].maxDwell + OOK_CHANNEL_HOLD)
+        return false;
+      hop(now);
+      return true;
+    }
+
+    void clearStats () {
+      for (uint8_t i = 0; i < count; ++i)
+        ch[i].hops = ch[i].decodes = 0;
+    }
+
+  private:
+    RADIO& rf;
+    Channel ch[OOK_CHANNELS];
+    uint8_t count, cur;
+    uint32_t start, deadline;  // ms, of the current slice
+
+    bool busy () const {
+      for (DecodeOOK** d = ch[cur].decoders; *d; ++d)
+        if (!(*d)->isIdle())
+          return true;
+      return false;
+    }
+
+    void hop (uint32_t now) {
+      for (DecodeOOK** d = ch[cur].decoders; *d; ++d)
+        (*d)->resetDecoder();
+      uint8_t from = cur;
+      if (++cur >= count) {
+        cur = 0;
+        learn();
+      }
+      uint32_t t = micros();
+      hopRegs = rf.switchContext(ch[from].image, ch[cur].image);
+      rf.clearAFC(); // AFCFEI is not in the image, it holds triggers
+      rf.enter_receive();
+      hopUs = micros() - t;
+      ++ch[cur].hops;
+      start = now;
+      deadline = now + ch[cur].dwell;
+    }
+
+    // share the time above minDwell out by score, then let the scores decay
+    // so the plan follows changes in traffic
+    void learn () {
+      uint32_t total = 0;
+      for (uint8_t i = 0; i < count; ++i)
+        total += ch[i].score;
+      for (uint8_t i = 0; i < count; ++i) {
+        Channel& c = ch[i];
+        c.dwell = c.minDwell;
+        if (total > 0)
+          c.dwell += (uint32_t) (c.maxDwell - c.minDwell) * c.score / total;
+        c.score -= c.score >> 2;
+      }
+    }
+};
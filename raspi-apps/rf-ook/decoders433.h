@@ -53,8 +53,10 @@ class WS249 : public DecodeOOK {
       if (width >= 5400 && pos >= 8) {
         return 1;
       }
-      if (pos >= 16)
-        return pos = bits = 1;
+      if (pos >= 16) {
+        truncate(9); // overlong, only report the start
+        return 1;
+      }
       return -1;
     }
 };
@@ -115,8 +117,10 @@ class Philips : public DecodeOOK {
           return -1;
         }
       }
-      if (pos >= 16)
-        return pos = bits = 1;
+      if (pos >= 16) {
+        truncate(9); // overlong, only report the start
+        return 1;
+      }
       return -1;
     }
 };
@@ -129,20 +133,6 @@ class OregonDecoderV1 : public DecodeOOK {
     OregonDecoderV1 () {}
     OregonDecoderV1 (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb) {}
 
-    // add one bit to the packet data buffer
-    virtual void gotBit (int8_t value) {
-      //Serial.print(value, BIN);
-      data[pos] = (data[pos] >> 1) | (value ? 0x80 : 00);
-      total_bits++;
-      pos = total_bits >> 3;
-      if (pos >= sizeof data) {
-        resetDecoder();
-        //Serial.print("gotBit reset");
-        return;
-      }
-      state = OK;
-    }
-
     virtual int8_t decode (uint16_t width) {
       //the detection algorithm does not explicitely make use of knwoledge on on or off states.
       //the algorithm looks at transitions of the signal.
@@ -222,25 +212,29 @@ class OregonDecoderV1 : public DecodeOOK {
 };
 
 class OregonDecoderV2 : public DecodeOOK {
+  private:
+    uint8_t raw; // bits received, including the inverted copies
   public:
-    OregonDecoderV2() {}
-    OregonDecoderV2 (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb) {}
+    OregonDecoderV2() : raw(0) {
+      setPreamble(700, 1200, 16); // 32 long pulses
+    }
+    OregonDecoderV2 (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb), raw(0) {
+      setPreamble(700, 1200, 16); // 32 long pulses
+    }
 
-    // add one bit to the packet data buffer
+    // add one bit to the packet data buffer, every bit is sent twice so only
+    // keep the even ones
     virtual void gotBit (int8_t value) {
-      if (!(total_bits & 0x01))
-      {
-        data[pos] = (data[pos] >> 1) | (value ? 0x80 : 00);
-      }
-      total_bits++;
-      pos = total_bits >> 4;
-      if (pos >= sizeof data) {
-        resetDecoder();
-        return;
-      }
+      if (!(raw++ & 0x01))
+        DecodeOOK::gotBit(value);
       state = OK;
     }
 
+    virtual void resetDecoder () {
+      raw = 0;
+      DecodeOOK::resetDecoder();
+    }
+
     virtual int8_t decode (uint16_t width) {
       if (200 <= width && width < 1200) {
         uint8_t w = width >= 700;
@@ -280,25 +274,17 @@ class OregonDecoderV2 : public DecodeOOK {
       } else {
         return -1;
       }
-      return total_bits == 160 ? 1 : 0;
+      return raw == 160 ? 1 : 0;
     }
 };
 
 class OregonDecoderV3 : public DecodeOOK {
   public:
-    OregonDecoderV3() {}
-    OregonDecoderV3 (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb) {}
-
-    // add one bit to the packet data buffer
-    virtual void gotBit (int8_t value) {
-      data[pos] = (data[pos] >> 1) | (value ? 0x80 : 00);
-      total_bits++;
-      pos = total_bits >> 3;
-      if (pos >= sizeof data) {
-        resetDecoder();
-        return;
-      }
-      state = OK;
+    OregonDecoderV3() {
+      setPreamble(200, 700, 16); // 32 short pulses
+    }
+    OregonDecoderV3 (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb) {
+      setPreamble(200, 700, 16); // 32 short pulses
     }
 
     virtual int8_t decode (uint16_t width) {
@@ -337,8 +323,12 @@ class OregonDecoderV3 : public DecodeOOK {
 /// OOK decoder for Oregon Scientific devices.
 class OregonDecoder : public DecodeOOK {
   public:
-    OregonDecoder () {}
-    OregonDecoder (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb) {}
+    OregonDecoder () {
+      setPreamble(200, 700, 8); // at least 10 short pulses
+    }
+    OregonDecoder (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb) {
+      setPreamble(200, 700, 8); // at least 10 short pulses
+    }
 
     virtual int8_t decode (uint16_t width) {
       if (200 <= width && width < 1200) {
@@ -652,7 +642,7 @@ class ElroDecoder : public DecodeOOK {
 // The following three decoders were contributed bij Gijs van Duimen:
 //    FlamingoDecoder = Flamingo FA15RF
 //    SmokeDecoder = Flamingo FA12RF
-//    ByronbellDecoder = Byron SX30T
+//    ByronbellDecoder = Byron SX30T, now the BYR row of pwmProtocols433
 // see http://www.domoticaforum.eu/viewtopic.php?f=17&t=4960&start=90#p51118
 // there's some weirdness in this code, I've edited it a bit -jcw, 2011-10-16
 
@@ -690,25 +680,295 @@ class SmokeDecoder : public DecodeOOK {
         //     uint8_t w = width < 100;
         return 0;
       }
-      if (pos >= 4)
-        return pos = bits = 1;
+      if (pos >= 4) {
+        // every element is a 1 and the train length depends on where
+        // reception started, a fixed 9 bits lets repeats compare equal
+        truncate(9);
+        return 1;
+      }
       return -1;
     }
 };
 
-/// OOK decoder for Byronbell devices.
-class ByronbellDecoder : public DecodeOOK {
+/// Timing of a pulse-width / tri-state protocol, in the style of the RcSwitch
+/// protocol table. All timings are multiples of the base pulse length. A data
+/// bit is a sequence of 1..4 elements (alternating high and low), given as one
+/// multiple per nibble, first element in the highest used nibble. A tri-state
+/// bit is just a 4-element symbol, e.g. PT2262 "0" = 0x1313.
+/// A protocol without a sync element (0, 0) is framed by gaps instead: a frame
+/// is a run of data elements, which ends at the first width that is not one.
+/// Such a frame is reported if it has at least minBits bits, and only its
+/// first maxBits bits are kept.
+struct PwmProtocol {
+  const char* tag;
+  uint16_t pulse;             // base pulse length in us
+  uint8_t syncHigh, syncLow;  // sync element, marks start and end of a frame
+  uint16_t zero, one;         // element multiples (1..13) per nibble
+  uint8_t elements;           // elements per bit
+  uint8_t minBits, maxBits;   // frame length, at most 32 bits kept
+};
+
+// Table of protocols matched by PwmDecoder. Adding a protocol is adding a row.
+// RcSwitch protocol 1 is left out, as it is the binary view of the KAKU row.
+// BYR is the Byron SX30T doorbell: a long train of 670 and 5360 us elements,
+// one bit each, of which the first 9 bits are reported. The train length
+// depends on where reception started, so a longer report would defeat the
+// repeat suppression.
+// The decoders above stay hand-coded, they do not fit this table:
+//   ElroDecoder      frames of 88 to 200 bits, and a 0-1-0 sync pattern of
+//                    short elements inside the stream
+//   FlamingoDecoder  two unrelated width windows per bit value, and frames of
+//                    32 bits and more that are reported whole
+//   SmokeDecoder     three unrelated width windows that all mean the same bit
+//   HezDecoder       frames of unknown length of which the last 50 bits are
+//                    kept, aligned to the end
+static const PwmProtocol pwmProtocols433[] = {
+  //  tag      pulse  sync      zero    one     el  bits
+  { "KAKU ",   350,   1, 31,   0x1313, 0x1331,  4, 12, 12 }, // PT2262, F = 1
+  { "RCS2 ",   650,   1, 10,   0x12,   0x21,    2,  8, 32 },
+  { "RCS3 ",   100,  30, 71,   0x4B,   0x96,    2,  8, 32 },
+  { "RCS4 ",   380,   1,  6,   0x13,   0x31,    2,  8, 32 },
+  { "RCS5 ",   500,   6, 14,   0x12,   0x21,    2,  8, 32 },
+  { "HT6P ",   450,  23,  1,   0x12,   0x21,    2,  8, 32 }, // inverted
+  { "BYR  ",   670,   0,  0,   0x1,    0x8,     1, 64,  9 }, // gap framed
+};
+
+#define PWM_MAX_PROTOCOLS 8 // fits the uint8_t masks below
+#define PWM_BUCKETS 89      // width < 32us, then 8 buckets per octave up to 64ms
+
+/// Table driven decoder for PWM and tri-state protocols. Each edge is
+/// quantized once into a log-spaced width bucket. A table built at startup
+/// maps each bucket to the pulse multiple it represents for every protocol,
+/// so per edge only protocols inside a frame, or seeing their sync, do work.
+/// Decoded bits are packed LSB first, like gotBit() does.
+class PwmDecoder : public DecodeOOK {
+    enum { PWM_NONE = 0, PWM_LEAD = 14, PWM_SYNC = 15 };
+
+    struct PwmState {
+      uint32_t acc;   // received bits, first bit in bit 0
+      uint16_t sym;   // element multiples of the current bit
+      uint16_t err;   // sum of the element timing errors, 1/256 of nominal
+      uint8_t nerr;   // elements in err
+      uint8_t nbits, nelem, skip;
+    };
+
+    const PwmProtocol* protocols;
+    uint8_t count;
+    uint8_t active;     // protocols inside a frame
+    uint8_t gapped;     // protocols framed by gaps, see PwmProtocol
+    uint8_t protocol;   // index of last decoded protocol
+    uint16_t last;      // previous width, the high part of a sync
+    PwmState st[PWM_MAX_PROTOCOLS];
+    uint8_t classes[PWM_BUCKETS][(PWM_MAX_PROTOCOLS + 1) / 2];
+    uint8_t syncMask[PWM_BUCKETS];
+
+    // shared width quantizer
+    static uint8_t bucket (uint16_t width) {
+      if (width < 32)
+        return 0;
+      uint8_t e = 5;
+      while (width >> (e + 1))
+        ++e;
+      return 1 + ((e - 5) << 3) + ((width >> (e - 3)) & 7);
+    }
+
+    // the long element of the sync and the short one next to it
+    static uint8_t marker (const PwmProtocol& p) {
+      return p.syncHigh > p.syncLow ? p.syncHigh : p.syncLow;
+    }
+    static uint8_t lead (const PwmProtocol& p) {
+      return p.syncHigh > p.syncLow ? p.syncLow : p.syncHigh;
+    }
+
+    // true if width is k pulses within the tolerance of data elements
+    static bool near (uint32_t width, uint8_t k, const PwmProtocol& p) {
+      uint32_t kt = (uint32_t) k * p.pulse;
+      uint32_t err = width > kt ? width - kt : kt - width;
+      return err <= kt / 2 + p.pulse / 4;
+    }
+
+    // classify a width for one protocol: a data multiple, sync lead, sync or
+    // none. The sync is matched within 25%, as several rows have long syncs
+    // of similar length. Without a sync only the element widths tell a frame
+    // from noise, so they are matched tighter then.
+    static uint8_t classify (uint32_t width, const PwmProtocol& p) {
+      uint8_t marker = PwmDecoder::marker(p);
+      uint8_t lead = PwmDecoder::lead(p);
+      uint32_t sync = (uint32_t) marker * p.pulse;
+      uint32_t syncErr = width > sync ? width - sync : sync - width;
+      if (marker != 0 && syncErr <= sync / 4)
+        return PWM_SYNC;
+      uint8_t best = PWM_NONE;
+      uint32_t bestErr = ~(uint32_t) 0;
+      uint8_t n = marker != 0 ? 2 * p.elements + 1 : 2 * p.elements;
+      for (uint8_t i = 0; i < n; ++i) {
+        uint8_t k = i < p.elements ? (p.zero >> (4 * i)) & 0x0F
+                  : i < 2 * p.elements ? (p.one >> (4 * (i - p.elements))) & 0x0F
+                  : lead;
+        uint32_t kt = (uint32_t) k * p.pulse;
+        uint32_t err = width > kt ? width - kt : kt - width;
+        uint32_t tol = marker != 0 ? kt / 2 : kt / 8;
+        if (err <= tol + p.pulse / 4 && err < bestErr) {
+          bestErr = err;
+          best = i < 2 * p.elements ? k : (uint8_t) PWM_LEAD;
+        }
+      }
+      return best;
+    }
+
+    // true if frame a matched the timing of its protocol better than frame b
+    // did, by the mean relative error of their elements
+    static bool closer (const PwmState& a, const PwmState& b) {
+      return (uint32_t) a.err * (b.nerr ? b.nerr : 1)
+           < (uint32_t) b.err * (a.nerr ? a.nerr : 1);
+    }
+
+    // copy the kept bits of a frame of protocol p to the packet buffer
+    void report (const PwmState& s, uint8_t p) {
+      uint8_t n = s.nbits < protocols[p].maxBits ? s.nbits : protocols[p].maxBits;
+      for (pos = 0; 8 * pos < n; ++pos)
+        data[pos] = s.acc >> (8 * pos);
+      total_bits = n;
+      bits = 0;
+      protocol = p;
+    }
+
+    uint8_t classOf (uint8_t b, uint8_t p) const {
+      return (classes[b][p >> 1] >> ((p & 1) << 2)) & 0x0F;
+    }
+
   public:
-    ByronbellDecoder () {}
-    ByronbellDecoder (uint8_t id, const char* tag, decoded_cb cb) : DecodeOOK (id, tag, cb) {}
+    PwmDecoder (const PwmProtocol* table = pwmProtocols433,
+                uint8_t n = sizeof pwmProtocols433 / sizeof *pwmProtocols433) {
+      setProtocols(table, n);
+    }
+    PwmDecoder (uint8_t id, const char* tag, decoded_cb cb,
+                const PwmProtocol* table = pwmProtocols433,
+                uint8_t n = sizeof pwmProtocols433 / sizeof *pwmProtocols433)
+      : DecodeOOK (id, tag, cb) {
+      setProtocols(table, n);
+    }
+
+    void setProtocols (const PwmProtocol* table, uint8_t n) {
+      protocols = table;
+      count = n < PWM_MAX_PROTOCOLS ? n : PWM_MAX_PROTOCOLS;
+      active = gapped = protocol = 0;
+      last = 0;
+      for (uint8_t p = 0; p < PWM_MAX_PROTOCOLS; ++p)
+        st[p].skip = 0;
+      for (uint8_t b = 0; b < PWM_BUCKETS; ++b) {
+        // bucket center
+        uint32_t width = 16;
+        if (b > 0) {
+          uint8_t e = 5 + ((b - 1) >> 3);
+          width = ((uint32_t) (8 + ((b - 1) & 7)) << (e - 3)) + (1UL << (e - 4));
+        }
+        syncMask[b] = 0;
+        for (uint8_t i = 0; i < sizeof classes[b]; ++i)
+          classes[b][i] = 0;
+        for (uint8_t p = 0; p < count; ++p) {
+          if (protocols[p].syncHigh == 0 && protocols[p].syncLow == 0)
+            gapped |= 1 << p;
+          uint8_t c = classify(width, protocols[p]);
+          classes[b][p >> 1] |= c << ((p & 1) << 2);
+          if (c == PWM_SYNC)
+            syncMask[b] |= 1 << p;
+        }
+      }
+    }
 
+    // index into the protocol table of the last decoded packet
+    uint8_t getProtocol () const {
+      return protocol;
+    }
+
+    virtual const char* packetTag () const {
+      return protocols[protocol].tag;
+    }
+
+    // A row only takes a sync after its own lead, or for an inverted sync
+    // before it. When several rows complete a frame on the same edge, the
+    // one whose elements were closest to its timing is reported, as rows
+    // with similar syncs accept each other's elements.
     virtual int8_t decode (uint16_t width) {
-      if (660 < width && width < 715 || 5100 < width && width < 5400) {
-        gotBit(width > 1000);
-        return 0;
+      uint8_t b = bucket(width);
+      uint8_t run = active | syncMask[b] | gapped;
+      uint8_t found = PWM_MAX_PROTOCOLS;  // row of the frame to report
+      PwmState frame;
+      for (uint8_t p = 0; run; ++p, run >>= 1) {
+        if (!(run & 1))
+          continue;
+        const PwmProtocol& proto = protocols[p];
+        PwmState& s = st[p];
+        uint8_t mask = 1 << p;
+        uint8_t k = classOf(b, p);
+        if (k == PWM_SYNC) {
+          bool inverted = proto.syncHigh > proto.syncLow;
+          if (!inverted && !near(last, lead(proto), proto)) {
+            active &= ~mask; // another row's sync
+            continue;
+          }
+          if ((active & mask) && s.nbits >= proto.minBits &&
+              (found == PWM_MAX_PROTOCOLS || closer(s, frame))) {
+            // report this frame, the sync also starts the next one
+            frame = s;
+            found = p;
+          }
+          s.acc = s.sym = s.nbits = s.nelem = s.err = s.nerr = 0;
+          s.skip = inverted; // low part of an inverted sync
+          active |= mask;
+        } else if (k == PWM_NONE) {
+          if ((gapped & active & mask) && s.nbits >= proto.minBits &&
+              (found == PWM_MAX_PROTOCOLS || closer(s, frame))) {
+            frame = s;
+            found = p;
+          }
+          active &= ~mask;
+        } else if (s.skip) {
+          --s.skip;
+          if (!near(width, lead(proto), proto))
+            active &= ~mask;
+        } else if (k == PWM_LEAD) {
+          // high part of the sync, wait for the sync itself
+        } else {
+          if (!(active & mask)) {
+            // first element of a gap framed protocol
+            s.acc = s.sym = s.nbits = s.nelem = s.err = s.nerr = 0;
+            active |= mask;
+          }
+          s.sym = (s.sym << 4) | k;
+          if (s.nbits < proto.maxBits) {
+            uint32_t kt = (uint32_t) k * proto.pulse;
+            uint32_t e = width > kt ? width - kt : kt - width;
+            s.err += (e << 8) / kt;
+            ++s.nerr;
+          }
+          if (++s.nelem == proto.elements) {
+            uint8_t value;
+            if (s.sym == proto.zero)
+              value = 0;
+            else if (s.sym == proto.one)
+              value = 1;
+            else {
+              active &= ~mask;
+              continue;
+            }
+            s.sym = s.nelem = 0;
+            if (s.nbits >= proto.maxBits) {
+              if (!(gapped & mask))
+                active &= ~mask;
+              else if (s.nbits < 255)
+                ++s.nbits; // counted, not kept
+              continue;
+            }
+            s.acc |= (uint32_t) value << s.nbits++;
+          }
+        }
       }
-      if (pos >= 8)
-        return pos = bits = 1;
-      return -1;
+      last = width;
+      if (found == PWM_MAX_PROTOCOLS)
+        return 0;
+      report(frame, found);
+      return 1;
     }
 };
@@ -0,0 +1,119 @@
+//============================================================================
+// Name        : crc-bench.cpp
+// Description : Host check and benchmark of the CRC variants in crc.h
+//
+// Built once per CRC_SLICING value (see Makefile). Each build checks the
+// nibble table update() and the block() of its variant against bit-serial
+// reference implementations, for every length up to 77 bytes and every
+// start offset, then times them. Exits with 1 on a mismatch.
+//============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../crc.h"
+
+// the avr-libc reference loops
+static uint16_t crc16Ref(uint16_t crc, uint8_t a) {
+	crc ^= a;
+	for (uint8_t i = 0; i < 8; ++i)
+		crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+	return crc;
+}
+
+static uint16_t crcCcittRef(uint16_t crc, uint8_t data) {
+	data ^= crc & 0xFF;
+	data ^= data << 4;
+	return ((((uint16_t) data << 8) | (crc >> 8)) ^ (uint8_t) (data >> 4)
+			^ ((uint16_t) data << 3));
+}
+
+static uint8_t crc8Ref(uint8_t crc, uint8_t in) {
+	for (uint8_t i = 8; i; i--) {
+		uint8_t mix = (crc ^ in) & 0x01;
+		crc >>= 1;
+		if (mix)
+			crc ^= 0x8C;
+		in >>= 1;
+	}
+	return crc;
+}
+
+static uint64_t nanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+enum { BUF = 4096, ROUNDS = 2000 };
+static uint8_t buf[BUF + 8];
+static volatile uint32_t sink;
+
+// ns per byte of f over len byte blocks
+template<typename F>
+static double timeIt(F f, uint16_t len) {
+	uint32_t n = (uint32_t) ROUNDS * BUF / len;
+	uint64_t t = nanos();
+	for (uint32_t i = 0; i < n; ++i)
+		sink += f(buf + (i & 7), len);
+	return (double) (nanos() - t) / ((double) n * len);
+}
+
+static int errors = 0;
+
+template<typename CRC, typename T>
+static void check(const char* name, T (*ref)(T, uint8_t), T init) {
+	for (uint8_t off = 0; off < 8; ++off) {
+		for (uint16_t len = 0; len <= 77; ++len) {
+			T r = init, u = init;
+			for (uint16_t i = 0; i < len; ++i) {
+				r = ref(r, buf[off + i]);
+				u = CRC::update(u, buf[off + i]);
+			}
+			T b = CRC::block(init, buf + off, len);
+			if (u != r || b != r) {
+				printf("%s len %d off %d: ref %x update %x block %x\n", name, len, off,
+						r, u, b);
+				++errors;
+				return;
+			}
+		}
+	}
+}
+
+int main() {
+	srand(1);
+	for (uint16_t i = 0; i < sizeof buf; ++i)
+		buf[i] = rand();
+
+	check<Crc16>("crc16", crc16Ref, (uint16_t) 0xFFFF);
+	check<CrcCcitt>("ccitt", crcCcittRef, (uint16_t) 0xFFFF);
+	check<Crc8Dallas>("crc8", crc8Ref, (uint8_t) 0);
+
+	// 10 bytes: a WH1080 packet, 64: a full EC3K frame, 4096: throughput
+	static const uint16_t lens[] = { 10, 64, BUF };
+	for (uint8_t i = 0; i < 3; ++i) {
+		uint16_t len = lens[i];
+		double ref = timeIt([](const uint8_t* p, uint16_t n) {
+			uint16_t c = 0xFFFF;
+			while (n--)
+				c = crc16Ref(c, *p++);
+			return c;
+		}, len);
+		double nib = timeIt([](const uint8_t* p, uint16_t n) {
+			uint16_t c = 0xFFFF;
+			while (n--)
+				c = Crc16::update(c, *p++);
+			return c;
+		}, len);
+		double blk = timeIt([](const uint8_t* p, uint16_t n) {
+			return Crc16::block(0xFFFF, p, n);
+		}, len);
+		printf("CRC_SLICING=%d crc16 %4d bytes: bit-serial %5.2f nibble %5.2f block %5.2f ns/byte\n",
+				CRC_SLICING, len, ref, nib, blk);
+	}
+	if (errors)
+		printf("CRC_SLICING=%d: %d mismatches\n", CRC_SLICING, errors);
+	return errors != 0;
+}
@@ -0,0 +1,729 @@
+//============================================================================
+// Name        : gen-corpus.cpp
+// Description : Writes the replay corpus of the OOK decoders
+//
+// One .ook file per protocol, see replay.cpp for the format. The frames are
+// built from the protocol timing, not from the decoder code, and the
+// expected output is worked out from the payload the same way: what the
+// decoder packs (LSB first, see bitbuffer.h), aligns or reverses. Payloads
+// seen in ook.log are used where there are any. Widths get a few percent of
+// deterministic jitter, so the files only change when this program does.
+//
+//   ./gen-corpus corpus     rewrite corpus/*.ook
+//============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+#include "../crc.h"
+
+typedef std::vector<uint8_t> Bits;
+
+static uint32_t seed = 1;
+static double jitter = 0.04; // fraction of a width, per protocol
+
+static double rnd() { // -1..1
+	seed = seed * 1103515245 + 12345;
+	return ((seed >> 8) & 0xFFFF) / 32767.5 - 1.0;
+}
+
+/// Pulse train, positive widths are high, negative low, as in TRACE lines.
+/// Adding a width of the same level as the last one lengthens that pulse.
+struct Train {
+	std::vector<int> p;
+
+	void add(bool high, double us, bool exact = false) {
+		int w = (int) (exact ? us : us * (1.0 + jitter * rnd()) + 0.5);
+		if (!p.empty() && (p.back() > 0) == high)
+			w += abs(p.back()), p.pop_back();
+		if (w > 32767)
+			w = 32767;
+		p.push_back(high ? w : -w);
+	}
+	void h(double us) { add(true, us); }
+	void l(double us) { add(false, us); }
+	// silence, the receiver reports at most 32767us
+	void gap(int us = 30000) { add(false, us, true); }
+	bool high() const { return !p.empty() && p.back() > 0; }
+	// next element, alternating levels
+	void el(double us) { add(!high(), us); }
+};
+
+struct Record {
+	Train t;
+	std::vector<std::string> expect; // "TAG  ,hex"
+};
+
+static Bits bitsLsb(const char* hex) {
+	Bits b;
+	for (const char* s = hex; s[0] && s[1]; s += 2) {
+		unsigned v;
+		sscanf(s, "%2x", &v);
+		for (int i = 0; i < 8; ++i)
+			b.push_back((v >> i) & 1);
+	}
+	return b;
+}
+
+static Bits bitsMsb(const char* hex) {
+	Bits b;
+	for (const char* s = hex; s[0] && s[1]; s += 2) {
+		unsigned v;
+		sscanf(s, "%2x", &v);
+		for (int i = 7; i >= 0; --i)
+			b.push_back((v >> i) & 1);
+	}
+	return b;
+}
+
+// packed as the decoders do, a partial last byte padded with zeros
+static std::string hexLsb(const Bits& b) {
+	std::string s;
+	for (size_t i = 0; i < b.size(); i += 8) {
+		unsigned v = 0;
+		for (size_t j = 0; j < 8 && i + j < b.size(); ++j)
+			v |= b[i + j] << j;
+		char x[3];
+		snprintf(x, sizeof x, "%02x", v);
+		s += x;
+	}
+	return s;
+}
+
+// after reverseBits(), the first bit in the MSB
+static std::string hexMsb(const Bits& b) {
+	std::string s;
+	for (size_t i = 0; i < b.size(); i += 8) {
+		unsigned v = 0;
+		for (size_t j = 0; j < 8 && i + j < b.size(); ++j)
+			v |= b[i + j] << (7 - j);
+		char x[3];
+		snprintf(x, sizeof x, "%02x", v);
+		s += x;
+	}
+	return s;
+}
+
+static std::string expect(const char* tag, const std::string& hex) {
+	return std::string(tag) + "," + hex;
+}
+
+//----------------------------------------------------------------------------
+// Encoders, one frame each. The comments give the elements as high/low
+// multiples of the base pulse.
+
+// PT2262 and the RcSwitch protocols: sync, then bits of elements
+struct Pwm {
+	const char* tag;
+	int pulse, syncHigh, syncLow, zero, one, elements;
+};
+
+static const Pwm pwmRows[] = {
+	{ "KAKU ", 350,  1, 31, 0x1313, 0x1331, 4 },
+	{ "RCS2 ", 650,  1, 10, 0x12,   0x21,   2 },
+	{ "RCS3 ", 100, 30, 71, 0x4B,   0x96,   2 },
+	{ "RCS4 ", 380,  1,  6, 0x13,   0x31,   2 },
+	{ "RCS5 ", 500,  6, 14, 0x12,   0x21,   2 },
+	{ "HT6P ", 450, 23,  1, 0x12,   0x21,   2 },
+};
+
+static void pwmSync(Train& t, const Pwm& p) {
+	t.h(p.syncHigh * p.pulse);
+	t.l(p.syncLow * p.pulse);
+}
+
+static void pwmBits(Train& t, const Pwm& p, const Bits& b) {
+	for (size_t i = 0; i < b.size(); ++i) {
+		int sym = b[i] ? p.one : p.zero;
+		for (int e = p.elements - 1; e >= 0; --e)
+			t.el(((sym >> (4 * e)) & 0x0F) * p.pulse);
+	}
+}
+
+// sync, then a sync after every copy, which ends the frame
+static Record pwmRecord(const Pwm& p, const char* hex, int nbits, int copies) {
+	Record r;
+	Bits b = bitsLsb(hex);
+	b.resize(nbits);
+	pwmSync(r.t, p);
+	for (int i = 0; i < copies; ++i) {
+		pwmBits(r.t, p, b);
+		pwmSync(r.t, p);
+	}
+	r.t.gap();
+	r.expect.push_back(expect(p.tag, hexLsb(b)));
+	return r;
+}
+
+// Byron SX30T, gap framed: 670us and 5360us elements, one bit each, the
+// first 9 bits are reported
+static Record byron(const char* code9, int copies) {
+	Record r;
+	Bits code;
+	for (const char* s = code9; *s; ++s)
+		code.push_back(*s == '1');
+	for (int i = 0; i < copies; ++i) {
+		for (int k = 0; k < 72; ++k)
+			r.t.el(code[k % 9] ? 5360 : 670);
+		r.t.gap(20000);
+	}
+	r.expect.push_back(expect("BYR  ", hexLsb(code)));
+	return r;
+}
+
+// Elro: 135, 325 and 515us elements, 0 = (135 325 515), 1 = (515 325 135),
+// a 0-1-0-1 sync pattern in front, a 135us stop element
+static Record elro(const char* hex, int copies) {
+	static const int w[3] = { 135, 325, 515 };
+	Record r;
+	Bits b = bitsLsb(hex);
+	for (int i = 0; i < copies; ++i) {
+		for (int k = 0; k < 8; ++k)
+			r.t.el(w[k & 1]);
+		for (size_t k = 0; k < b.size(); ++k)
+			for (int e = 0; e < 3; ++e)
+				r.t.el(w[b[k] ? 2 - e : e]);
+		if (!r.t.high())
+			r.t.el(w[0]);
+		r.t.gap(10000);
+	}
+	r.expect.push_back(expect("ELRO ", hexLsb(b)));
+	return r;
+}
+
+// Flamingo FA15RF: one element per bit, 760us = 0, 1200us = 1
+static Record flamingo(const char* hex, int nbits, int copies) {
+	Record r;
+	Bits b = bitsLsb(hex);
+	b.resize(nbits);
+	for (int i = 0; i < copies; ++i) {
+		for (size_t k = 0; k < b.size(); ++k)
+			r.t.el(b[k] ? 1200 : 760);
+		r.t.gap(20000);
+	}
+	r.expect.push_back(expect("FMGO ", hexLsb(b)));
+	return r;
+}
+
+// Flamingo FA12RF smoke alarm: 6950us high and 6650us low elements, all 1,
+// reported as 9 bits
+static Record smoke(int elements) {
+	Record r;
+	for (int k = 0; k < elements; ++k)
+		r.t.el(k & 1 ? 6650 : 6950);
+	r.t.gap();
+	r.expect.push_back(expect("SMK  ", "ff01"));
+	return r;
+}
+
+// FS20 HEZ: one element per bit, 400us = 0, 800us = 1. The decoder adds 6
+// zero bits and keeps the last 7 bytes.
+static Record hez(const char* hex, int nbits) {
+	Record r;
+	Bits b = bitsLsb(hex);
+	b.resize(nbits);
+	for (size_t k = 0; k < b.size(); ++k)
+		r.t.el(b[k] ? 800 : 400);
+	r.t.gap();
+	Bits e = b;
+	e.resize(e.size() + 6, 0);
+	e.erase(e.begin(), e.begin() + e.size() % 8);
+	if (e.size() > 56)
+		e.erase(e.begin(), e.end() - 56);
+	r.expect.push_back(expect("HEZ  ", hexLsb(e)));
+	return r;
+}
+
+// X10: 8.8ms high, 4.4ms low leader, bits of 560us high and 560us (0) or
+// 1690us (1) low, a 560us stop pulse
+static Record xrf(const char* hex, int copies) {
+	Record r;
+	Bits b = bitsLsb(hex);
+	for (int i = 0; i < copies; ++i) {
+		r.t.h(8800);
+		r.t.l(4400);
+		for (size_t k = 0; k < b.size(); ++k) {
+			r.t.h(560);
+			r.t.l(b[k] ? 1690 : 560);
+		}
+		r.t.h(560);
+		r.t.gap(30000);
+	}
+	r.expect.push_back(expect("XRF  ", hexLsb(b)));
+	return r;
+}
+
+// KAKU type A, T = 260us: sync (1 10), 0 = (1 1 1 5), 1 = (1 5 1 1), a stop
+// pulse and a 40T pause
+static Record kakuA(const char* hex, int copies) {
+	const int T = 260;
+	Record r;
+	Bits b = bitsLsb(hex);
+	for (int i = 0; i < copies; ++i) {
+		r.t.h(T);
+		r.t.l(10 * T);
+		for (size_t k = 0; k < b.size(); ++k) {
+			r.t.h(T);
+			r.t.l(b[k] ? 5 * T : T);
+			r.t.h(T);
+			r.t.l(b[k] ? T : 5 * T);
+		}
+		r.t.h(T);
+		r.t.l(40 * T);
+	}
+	r.t.gap();
+	r.expect.push_back(expect("KAKUA", hexLsb(b)));
+	return r;
+}
+
+// Cresta: 4 long (1000us) preamble elements, then 1 = long, 0 = two short
+// (500us) elements. The first bit is 0.
+static Record cresta(const char* hex) {
+	Record r;
+	Bits b = bitsLsb(hex);
+	for (int k = 0; k < 4; ++k)
+		r.t.el(1000);
+	for (size_t k = 0; k < b.size(); ++k) {
+		r.t.el(b[k] ? 1000 : 500);
+		if (!b[k])
+			r.t.el(500);
+	}
+	if (!r.t.high())
+		r.t.el(500);
+	r.t.gap();
+	r.expect.push_back(expect("CRES ", hexLsb(b)));
+	return r;
+}
+
+// WS249: sync of 700us high and 5750us low, bits of 700us high and 1000us
+// (0) or 2000us (1) low, 64 bits
+static Record ws249(const char* hex, int copies) {
+	Record r;
+	Bits b = bitsLsb(hex);
+	double j = jitter;
+	for (int i = 0; i < copies; ++i) {
+		r.t.h(700);
+		jitter = 0.03;
+		r.t.l(5750);
+		jitter = j;
+		for (size_t k = 0; k < b.size(); ++k) {
+			r.t.h(700);
+			r.t.l(b[k] ? 2000 : 1000);
+		}
+	}
+	r.t.h(700);
+	r.t.gap();
+	r.expect.push_back(expect("WS249", hexLsb(b)));
+	return r;
+}
+
+// Philips: 0 = 2ms high, 6ms low, 1 = 6ms high, 2ms low. A preamble of 0
+// bits, the first copy has 4 more. The last 32 bits are reported MSB first.
+static Record philips(const char* hex) {
+	Record r;
+	Bits b = bitsMsb(hex);
+	for (int i = 0; i < 3; ++i) {
+		for (int k = i ? 8 : 12; k > 0; --k) {
+			r.t.h(2000);
+			r.t.l(6000);
+		}
+		for (size_t k = 0; k < b.size(); ++k) {
+			r.t.h(b[k] ? 6000 : 2000);
+			r.t.l(b[k] ? 2000 : 6000);
+		}
+		r.t.gap();
+	}
+	r.expect.push_back(expect("PHI  ", hexMsb(b)));
+	return r;
+}
+
+// Manchester, as the Oregon decoders see it: a long element where the bit
+// changes, two short ones where it stays the same
+static void manchester(Train& t, const Bits& b, size_t from, int s, int l) {
+	for (size_t k = from; k < b.size(); ++k) {
+		if (b[k] != b[k - 1])
+			t.el(l);
+		else {
+			t.el(s);
+			t.el(s);
+		}
+	}
+}
+
+// Oregon V1: 12 one bits of preamble (24 x 1450us), three sync elements of
+// 4.2, 5.7 and 5.3ms, a longer last one if the first bit is 0. Sent twice.
+static Record oregonV1(const char* hex) {
+	Record r;
+	Bits b = bitsLsb(hex);
+	double j = jitter;
+	for (int i = 0; i < 2; ++i) {
+		for (int k = 0; k < 24; ++k)
+			r.t.el(1450);
+		r.t.el(4200);
+		r.t.el(5700);
+		r.t.el(b[0] ? 5300 : 6600);
+		if (b[0])
+			r.t.el(1450); // second half of the first bit
+		jitter = 0.03;
+		manchester(r.t, b, 1, 1450, 2900);
+		jitter = j;
+		if (!r.t.high())
+			r.t.el(1450);
+		r.t.gap(20000);
+	}
+	r.expect.push_back(expect("ORSV1", hexLsb(b)));
+	return r;
+}
+
+// Oregon V2: 36 long (980us) preamble elements, every bit is sent followed
+// by its inverse, the decoder keeps the first of each pair. The first bit,
+// the lowest of the 0xA sync nibble, is 0.
+static Record oregonV2(const char* hex) {
+	Record r;
+	Bits b = bitsLsb(hex), raw;
+	for (size_t k = 0; k < b.size(); ++k) {
+		raw.push_back(b[k]);
+		raw.push_back(!b[k]);
+	}
+	for (int k = 0; k < 36; ++k)
+		r.t.el(980);
+	r.t.el(490);
+	r.t.el(490);
+	manchester(r.t, raw, 1, 490, 980);
+	r.t.gap();
+	r.expect.push_back(expect("ORSV2", hexLsb(b)));
+	return r;
+}
+
+// Oregon V3: 40 short (490us) preamble elements, then Manchester bits, the
+// first one 0. OregonDecoder reports the same packet at the gap.
+static Record oregonV3(const char* hex) {
+	Record r;
+	Bits b = bitsLsb(hex);
+	for (int k = 0; k < 40; ++k)
+		r.t.el(490);
+	r.t.el(980);
+	manchester(r.t, b, 1, 490, 980);
+	r.t.gap();
+	r.expect.push_back(expect("ORSV3", hexLsb(b)));
+	r.expect.push_back(expect("ORSC ", hexLsb(b)));
+	return r;
+}
+
+// Fine Offset WH1080: 8 one bits of preamble, bits of 500us (1) or 1500us
+// (0) high and 1000us low, 9 bytes and a CRC-8, MSB first
+static Record wh1080(const char* hex9) {
+	Record r;
+	Bits b = bitsMsb(hex9);
+	// the decoder checks the CRC over the bytes packed LSB first
+	uint8_t lsb[9];
+	for (int i = 0; i < 9; ++i) {
+		lsb[i] = 0;
+		for (int j = 0; j < 8; ++j)
+			lsb[i] |= b[8 * i + j] << j;
+	}
+	uint8_t crc = Crc8Dallas::block(0, lsb, 9);
+	for (int j = 0; j < 8; ++j)
+		b.push_back((crc >> j) & 1);
+	for (int k = 0; k < 8; ++k) {
+		r.t.h(500);
+		r.t.l(1000);
+	}
+	for (size_t k = 0; k < b.size(); ++k) {
+		r.t.h(b[k] ? 500 : 1500);
+		r.t.l(1000);
+	}
+	r.t.h(500);
+	r.t.gap();
+	r.expect.push_back(expect("WH1080", hexMsb(b)));
+	r.expect.push_back(expect("WH10A", hexMsb(b)));
+	return r;
+}
+
+// Visonic: 0 = (400 800), 1 = (800 400), 36 bits. The decoder inverts the
+// bits so far at the start of every bit, so a bit is sent inverted when an
+// odd number of bits follow it. It adds 4 zero bits and only reports if the
+// nibbles of the xor of all bytes are equal. A 3ms pulse in front makes the
+// last element a high one.
+static Record visonic(const char* hex4) {
+	Record r;
+	Bits b = bitsLsb(hex4);
+	uint8_t x = 0;
+	for (int i = 0; i < 4; ++i)
+		x ^= strtoul(std::string(hex4 + 2 * i, 2).c_str(), 0, 16);
+	x = (x & 0x0F) ^ (x >> 4);
+	for (int j = 0; j < 4; ++j)
+		b.push_back((x >> j) & 1);
+	r.t.h(3000);
+	for (size_t k = 0; k < b.size(); ++k) {
+		uint8_t v = b[k] ^ ((b.size() - 1 - k) & 1);
+		r.t.el(v ? 800 : 400);
+		r.t.el(v ? 400 : 800);
+	}
+	r.t.gap();
+	Bits e = b;
+	e.resize(40, 0);
+	r.expect.push_back(expect("VISO ", hexLsb(e)));
+	return r;
+}
+
+// EM 1000: 12 zero bits (24 x 400us), a one bit, then 10 bytes LSB first,
+// each with a 1 stop bit. 0 = (400 400), 1 = (400 800). The last byte is
+// the xor of the others.
+static Record emx(const char* hex9) {
+	Record r;
+	Bits b;
+	uint8_t x = 0;
+	for (int i = 0; i < 10; ++i) {
+		uint8_t v = x;
+		if (i < 9)
+			v = strtoul(std::string(hex9 + 2 * i, 2).c_str(), 0, 16);
+		x ^= v;
+		for (int j = 0; j < 8; ++j)
+			b.push_back((v >> j) & 1);
+		b.push_back(1);
+	}
+	r.t.h(3000);
+	for (int k = 0; k < 24; ++k)
+		r.t.el(400);
+	r.t.el(400);
+	r.t.el(800);
+	for (size_t k = 0; k < b.size(); ++k) {
+		r.t.el(400);
+		r.t.el(b[k] ? 800 : 400);
+	}
+	r.t.gap();
+	r.expect.push_back(expect("EMX  ", hexLsb(b)));
+	return r;
+}
+
+// KS300: 0 = (800 400), 1 = (400 800), a preamble of 0 bits and the sync
+// elements (800 400 800 400 800 400 400 800)
+static Record ksx(const char* hex) {
+	static const int sync[8] = { 800, 400, 800, 400, 800, 400, 400, 800 };
+	Record r;
+	Bits b = bitsLsb(hex);
+	r.t.h(3000);
+	for (int k = 0; k < 10; ++k) {
+		r.t.el(800);
+		r.t.el(400);
+	}
+	for (int k = 0; k < 8; ++k)
+		r.t.el(sync[k]);
+	for (size_t k = 0; k < b.size(); ++k) {
+		r.t.el(b[k] ? 400 : 800);
+		r.t.el(b[k] ? 800 : 400);
+	}
+	r.t.gap();
+	r.expect.push_back(expect("KSX  ", hexLsb(b)));
+	return r;
+}
+
+// FS20: 12 zero bits and a one bit of sync, then house code, address,
+// command and checksum, each MSB first with even parity, and a 0 bit.
+// 0 = (400 400), 1 = (600 600). Sent three times.
+static Record fs20(uint16_t house, uint8_t addr, uint8_t cmd) {
+	Record r;
+	uint8_t bytes[5] = { (uint8_t) (house >> 8), (uint8_t) house, addr, cmd, 0 };
+	bytes[4] = 6 + bytes[0] + bytes[1] + bytes[2] + bytes[3];
+	Bits b;
+	b.push_back(1);
+	for (int i = 0; i < 5; ++i) {
+		uint8_t parity = 0;
+		for (int j = 7; j >= 0; --j) {
+			b.push_back((bytes[i] >> j) & 1);
+			parity ^= b.back();
+		}
+		b.push_back(parity);
+	}
+	b.push_back(0);
+	for (int i = 0; i < 3; ++i) {
+		for (int k = 0; k < 12; ++k) {
+			r.t.h(400);
+			r.t.l(400);
+		}
+		for (size_t k = 0; k < b.size(); ++k) {
+			r.t.h(b[k] ? 600 : 400);
+			r.t.l(b[k] ? 600 : 400);
+		}
+		r.t.gap(10000);
+	}
+	r.expect.push_back(expect("FS20 ", hexMsb(b)));
+	r.expect.push_back(expect("FS20A", hexMsb(b)));
+	return r;
+}
+
+// random widths, log spread over 50us..20ms, nothing expected
+static Record noise(int pulses) {
+	Record r;
+	for (int k = 0; k < pulses; ++k) {
+		double u = (rnd() + 1.0) / 2.0;
+		r.t.el(50 * exp(u * log(400.0)));
+	}
+	r.t.gap();
+	return r;
+}
+
+//----------------------------------------------------------------------------
+
+static const char* outDir = "corpus";
+
+static void write(const char* name, const char* about,
+		const std::vector<Record>& recs) {
+	std::string path = std::string(outDir) + "/" + name + ".ook";
+	FILE* f = fopen(path.c_str(), "w");
+	if (!f) {
+		perror(path.c_str());
+		exit(1);
+	}
+	fprintf(f, "# %s\n# written by gen-corpus, see replay.cpp for the format\n",
+			about);
+	for (size_t i = 0; i < recs.size(); ++i) {
+		const Record& r = recs[i];
+		const std::vector<int>& p = r.t.p;
+		std::string first = r.expect.empty() ? "-," : r.expect[0];
+		fprintf(f, "TRACE,%s,%u", first.c_str(), (unsigned) p.size());
+		for (size_t k = 0; k < p.size(); ++k)
+			fprintf(f, ",%d", p[k]);
+		fprintf(f, "\n");
+		for (size_t k = 1; k < r.expect.size(); ++k)
+			fprintf(f, "ALSO,%s\n", r.expect[k].c_str());
+	}
+	fclose(f);
+	printf("%-10s %d traces\n", name, (int) recs.size());
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1)
+		outDir = argv[1];
+	std::vector<Record> v;
+
+	// KAKU codes from ook.log
+	static const char* kakuLog[] = { "230e", "ff0f", "630e", "430e", "fb0f", "e30f" };
+	v.clear();
+	for (int i = 0; i < 6; ++i) {
+		Record r = pwmRecord(pwmRows[0], kakuLog[i], 12, 4);
+		r.expect.push_back(expect("KAKUC", r.expect[0].substr(6)));
+		v.push_back(r);
+	}
+	write("kaku", "PT2262 / KAKU: KAKU row of PwmDecoder and KakuDecoder", v);
+
+	v.clear();
+	for (int p = 1; p < 6; ++p) {
+		v.push_back(pwmRecord(pwmRows[p], "5a3c81", 24, 3));
+		v.push_back(pwmRecord(pwmRows[p], "e7100f42", 32, 3));
+	}
+	write("rcswitch", "RcSwitch protocols 2 to 6: rows of PwmDecoder", v);
+
+	v.clear();
+	v.push_back(byron("101100101", 3));
+	v.push_back(byron("011011100", 3));
+	write("byron", "Byron SX30T: BYR row of PwmDecoder", v);
+
+	v.clear();
+	jitter = 0.03;
+	v.push_back(elro("5155501554154555455551", 2));
+	v.push_back(elro("a1b2c3d4e5f60718293a4b5c", 2));
+	write("elro", "Elro: ElroDecoder", v);
+
+	v.clear();
+	jitter = 0.015;
+	v.push_back(flamingo("5455559b43", 39, 3));
+	v.push_back(flamingo("5455558d21", 39, 3));
+	write("flamingo", "Flamingo FA15RF: FlamingoDecoder", v);
+
+	v.clear();
+	jitter = 0.004;
+	v.push_back(smoke(39));
+	v.push_back(smoke(61));
+	write("smoke", "Flamingo FA12RF: SmokeDecoder", v);
+
+	v.clear();
+	jitter = 0.04;
+	v.push_back(hez("a55a0ff0c3961e", 51));
+	v.push_back(hez("1234567890abcd", 51));
+	write("hez", "FS20 HEZ: HezDecoder", v);
+
+	v.clear();
+	v.push_back(xrf("609f00ff", 3));
+	v.push_back(xrf("609f20df", 3));
+	write("xrf", "X10: XrfDecoder", v);
+
+	v.clear();
+	v.push_back(kakuA("9ac25e01", 3));
+	v.push_back(kakuA("9ac25e11", 3));
+	write("kakua", "KAKU type A: KakuADecoder", v);
+
+	v.clear();
+	v.push_back(cresta("9c85d4001e2f3c4b"));
+	v.push_back(cresta("02abcdef01234567"));
+	write("cresta", "Cresta: CrestaDecoder", v);
+
+	// WS249 packet from ook.log
+	v.clear();
+	v.push_back(ws249("cb0f813ee8030028", 3));
+	v.push_back(ws249("cb0f8140e8030029", 3));
+	write("ws249", "WS249 plant sensor: WS249", v);
+
+	// Philips packets from ook.log
+	v.clear();
+	v.push_back(philips("124a8056"));
+	v.push_back(philips("0923c02a"));
+	write("philips", "Philips outdoor sensor: Philips", v);
+
+	// Oregon V1 packets from ook.log
+	v.clear();
+	jitter = 0.03;
+	v.push_back(oregonV1("0e480258"));
+	v.push_back(oregonV1("0e470257"));
+	v.push_back(oregonV1("0e460256"));
+	v.push_back(oregonV1("4b071c6a"));
+	write("oregon1", "Oregon Scientific V1: OregonDecoderV1", v);
+
+	v.clear();
+	jitter = 0.04;
+	v.push_back(oregonV2("1a2d1002502060552a4c"));
+	v.push_back(oregonV2("ea4c10b4a3700230f44e"));
+	write("oregon2", "Oregon Scientific V2: OregonDecoderV2", v);
+
+	v.clear();
+	v.push_back(oregonV3("fa28a428202290080c3c"));
+	v.push_back(oregonV3("0a4d201e8501330e3d2b"));
+	write("oregon3", "Oregon Scientific V3: OregonDecoderV3 and OregonDecoder", v);
+
+	v.clear();
+	v.push_back(wh1080("a0148c4b050a002c03"));
+	v.push_back(wh1080("a1f2b83c0d1301f407"));
+	write("wh1080", "Fine Offset WH1080: WH1080DecoderV2 and V2a", v);
+
+	v.clear();
+	v.push_back(visonic("3c5a9601"));
+	v.push_back(visonic("e7184422"));
+	write("visonic", "Visonic: VisonicDecoder", v);
+
+	v.clear();
+	v.push_back(emx("02051b3412560078ff"));
+	v.push_back(emx("01021cc003200050aa"));
+	write("emx", "EM 1000: EMxDecoder", v);
+
+	v.clear();
+	v.push_back(ksx("1d3c7b9a0e55"));
+	v.push_back(ksx("a4000185ff20"));
+	write("ksx", "KS300: KSxDecoder", v);
+
+	v.clear();
+	v.push_back(fs20(0x1234, 0x01, 0x11));
+	v.push_back(fs20(0xabcd, 0x4f, 0x00));
+	write("fs20", "FS20: FSxDecoder and FSxDecoderA", v);
+
+	v.clear();
+	jitter = 0;
+	for (int i = 0; i < 4; ++i)
+		v.push_back(noise(2000));
+	write("noise", "Noise: random widths, no decoder should report", v);
+	return 0;
+}
@@ -0,0 +1,408 @@
+//============================================================================
+// Name        : replay.cpp
+// Description : Replays the pulse corpus through the OOK decoders
+//
+// Each corpus file holds pulse traces with the packets the decoders must
+// report for them. Lines:
+//   # ...                                comment
+//   TRACE,<tag>,<hex>,<count>,<pulse>,...
+//                                        count pulses in us, positive high,
+//                                        negative low, and the packet
+//                                        expected from them, as printOOK()
+//                                        prints it. Tag - expects nothing.
+//   ALSO,<tag>,<hex>                     one more packet expected from the
+//                                        TRACE line above
+// A TRACE line is what rf-ook prints with TRACELOG set, so a packet caught
+// in the field is added by appending its line to a file. Leading 0 pulses,
+// from a trace buffer that was not full yet, are skipped.
+//
+// Every trace goes through the same steps as in rf-ook: PreambleGate, then
+// nextPulse() of each decoder, and the end of transmission pulse of
+// receiveOOK(). A simulated clock runs with the pulses for the repeat
+// suppression and moves 30s ahead between traces. The reported packets are
+// diffed against the expected ones (- missing, + not expected), then the
+// corpus is timed over a number of rounds.
+//
+// Decodes known to be wrong are listed in a file of their own, one per line
+// as "<file>:<line> - <tag>,<hex>" for a missing packet or "+" for one not
+// expected, after a # comment that says why. They are reported apart and do
+// not fail the run; any other difference does.
+//
+//   replay [-k known] [-b baseline] [-t percent] [-w baseline] file...
+//     -k  the known failures
+//     -b  also fail if ns/pulse of the corpus grows more than -t percent
+//         (default 30) than in baseline
+//     -w  write ns/pulse of each file as the new baseline
+//============================================================================
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+static uint32_t simMicros;
+#define OOK_TENTHS() (simMicros / 100000)
+
+#include "decodeOOK.h"
+#include "decoders433.h"
+#include "decoders868.h"
+
+static std::vector<std::string> reported;
+
+// a known failure, "<file>:<line> <+|-> <tag>,<hex>"
+struct Known {
+	std::string where, diff;
+	bool seen;
+};
+static std::vector<Known> known;
+
+// true if this difference is a known failure
+static bool isKnown(const std::string& where, const std::string& diff) {
+	for (size_t i = 0; i < known.size(); ++i)
+		if (known[i].where == where && known[i].diff == diff) {
+			known[i].seen = true;
+			return true;
+		}
+	return false;
+}
+
+static void report(DecodeOOK* decoder) {
+	uint8_t pos;
+	const uint8_t* data = decoder->getData(pos);
+	std::string s = std::string(decoder->packetTag()) + ",";
+	for (uint8_t i = 0; i < pos; ++i) {
+		char x[3];
+		snprintf(x, sizeof x, "%02x", data[i]);
+		s += x;
+	}
+	reported.push_back(s);
+	decoder->resetDecoder();
+}
+
+// every decoder, with the tags of rf-ook.cpp, KakuDecoder is KAKUC as the
+// KAKU row of PwmDecoder reports as KAKU
+WS249 ws249(20, "WS249", report);
+Philips phi(21, "PHI  ", report);
+OregonDecoderV1 orscV1(22, "ORSV1", report);
+OregonDecoderV2 orscV2(5, "ORSV2", report);
+OregonDecoderV3 orscV3(23, "ORSV3", report);
+OregonDecoder orsc(24, "ORSC ", report);
+CrestaDecoder cres(6, "CRES ", report);
+KakuDecoder kaku(7, "KAKUC", report);
+XrfDecoder xrf(8, "XRF  ", report);
+HezDecoder hez(9, "HEZ  ", report);
+ElroDecoder elro(10, "ELRO ", report);
+FlamingoDecoder flam(11, "FMGO ", report);
+SmokeDecoder smok(12, "SMK  ", report);
+KakuADecoder kakuA(14, "KAKUA", report);
+PwmDecoder pwm(30, "PWM  ", report);
+WH1080DecoderV2 wh1080(40, "WH1080", report);
+WH1080DecoderV2a wh1080a(41, "WH10A", report);
+VisonicDecoder viso(1, "VISO ", report);
+EMxDecoder emx(2, "EMX  ", report);
+KSxDecoder ksx(3, "KSX  ", report);
+FSxDecoder fsx(4, "FS20 ", report);
+FSxDecoderA fsxa(44, "FS20A", report);
+
+DecodeOOK* decoders[] = {
+	&ws249, &phi, &orscV1, &orscV2, &orscV3, &orsc, &cres, &kaku, &xrf, &hez,
+	&elro, &flam, &smok, &kakuA, &pwm, &wh1080, &wh1080a, &viso, &emx, &ksx,
+	&fsx, &fsxa, NULL
+};
+PreambleGate gate;
+
+// as in rf-ook.cpp
+static void processBit(uint16_t pulse_dur, uint8_t signal, uint8_t rssi) {
+	gate.add(pulse_dur, signal, rssi);
+	for (uint8_t i = 0; decoders[i]; i++) {
+		if (gate.pass(decoders[i], pulse_dur) && decoders[i]->nextPulse(pulse_dur, signal, rssi))
+			decoders[i]->decoded(decoders[i]);
+	}
+}
+
+struct Trace {
+	int line;
+	std::vector<int> pulses;
+	std::vector<std::string> expect;
+};
+
+struct File {
+	std::string name;
+	std::vector<Trace> traces;
+	unsigned pulses, expected, found, extra;
+	unsigned known; // differences that are known failures
+	double ns; // per pulse
+};
+
+static bool load(const char* path, File& f) {
+	FILE* in = fopen(path, "r");
+	if (!in) {
+		perror(path);
+		return false;
+	}
+	const char* base = strrchr(path, '/');
+	f.name = base ? base + 1 : path;
+	f.pulses = 0;
+	std::string line;
+	int n = 0, c;
+	while ((c = fgetc(in)) != EOF || !line.empty()) {
+		if (c != '\n' && c != EOF) {
+			if (c != '\r')
+				line += (char) c;
+			continue;
+		}
+		++n;
+		std::vector<std::string> fields;
+		size_t start = 0, comma;
+		while ((comma = line.find(',', start)) != std::string::npos) {
+			fields.push_back(line.substr(start, comma - start));
+			start = comma + 1;
+		}
+		fields.push_back(line.substr(start));
+		if (fields[0] == "TRACE" && fields.size() >= 4) {
+			Trace t;
+			t.line = n;
+			if (fields[1] != "-")
+				t.expect.push_back(fields[1] + "," + fields[2]);
+			for (size_t i = 4; i < fields.size(); ++i) {
+				int w = atoi(fields[i].c_str());
+				if (w != 0 || !t.pulses.empty())
+					t.pulses.push_back(w);
+			}
+			f.pulses += t.pulses.size();
+			f.traces.push_back(t);
+		} else if (fields[0] == "ALSO" && fields.size() == 3 && !f.traces.empty()) {
+			f.traces.back().expect.push_back(fields[1] + "," + fields[2]);
+		} else if (!line.empty() && line[0] != '#') {
+			fprintf(stderr, "%s:%d: not a corpus line\n", path, n);
+			fclose(in);
+			return false;
+		}
+		line.clear();
+		if (c == EOF)
+			break;
+	}
+	fclose(in);
+	return true;
+}
+
+static void replay(const Trace& t) {
+	int last = 0;
+	for (size_t i = 0; i < t.pulses.size(); ++i) {
+		last = t.pulses[i];
+		uint16_t w = abs(last);
+		simMicros += w;
+		processBit(w, last > 0, 0);
+	}
+	// end of transmission, see receiveOOK()
+	processBit(1, last <= 0, 0);
+	simMicros += 30000000;
+}
+
+// diff the reported packets against the expected ones, any order
+static void check(File& f) {
+	f.expected = f.found = f.extra = f.known = 0;
+	for (size_t i = 0; i < f.traces.size(); ++i) {
+		const Trace& t = f.traces[i];
+		reported.clear();
+		replay(t);
+		std::vector<std::string> want = t.expect;
+		f.expected += want.size();
+		char where[80];
+		snprintf(where, sizeof where, "%s:%d", f.name.c_str(), t.line);
+		for (size_t j = 0; j < reported.size(); ++j) {
+			std::vector<std::string>::iterator k =
+				std::find(want.begin(), want.end(), reported[j]);
+			if (k != want.end()) {
+				want.erase(k);
+				f.found++;
+			} else if (isKnown(where, "+ " + reported[j])) {
+				f.known++;
+			} else {
+				printf("%s: + %s\n", where, reported[j].c_str());
+				f.extra++;
+			}
+		}
+		for (size_t j = 0; j < want.size(); ++j) {
+			if (isKnown(where, "- " + want[j]))
+				f.known++;
+			else
+				printf("%s: - %s\n", where, want[j].c_str());
+		}
+	}
+}
+
+static bool readKnown(const char* path) {
+	FILE* in = fopen(path, "r");
+	if (!in) {
+		perror(path);
+		return false;
+	}
+	char line[200];
+	int n = 0;
+	while (fgets(line, sizeof line, in)) {
+		++n;
+		char where[80], sign[2], packet[100];
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		// the tag is padded with spaces, the packet is the rest of the line
+		if (sscanf(line, "%79s %1s %99[^\r\n]", where, sign, packet) != 3 ||
+				(sign[0] != '+' && sign[0] != '-')) {
+			fprintf(stderr, "%s:%d: not a known failure line\n", path, n);
+			fclose(in);
+			return false;
+		}
+		Known k = { where, std::string(sign) + " " + packet, false };
+		known.push_back(k);
+	}
+	fclose(in);
+	return true;
+}
+
+static double nanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// fastest of several rounds for each file, the rounds go over all files in
+// turn to keep the noise of a busy host out
+static void timeFiles(std::vector<File>& files, int rounds) {
+	for (size_t k = 0; k < files.size(); ++k)
+		files[k].ns = 1e30;
+	for (int r = 0; r < rounds; ++r) {
+		for (size_t k = 0; k < files.size(); ++k) {
+			File& f = files[k];
+			double t0 = nanos();
+			for (size_t i = 0; i < f.traces.size(); ++i)
+				replay(f.traces[i]);
+			double t = (nanos() - t0) / (f.pulses ? f.pulses : 1);
+			if (t < f.ns)
+				f.ns = t;
+			reported.clear();
+		}
+	}
+}
+
+struct Baseline {
+	std::string name;
+	double ns;
+};
+
+static std::vector<Baseline> readBaseline(const char* path) {
+	std::vector<Baseline> v;
+	FILE* in = fopen(path, "r");
+	if (!in) {
+		perror(path);
+		exit(1);
+	}
+	char name[64];
+	Baseline b;
+	while (fscanf(in, "%63s %lf", name, &b.ns) == 2) {
+		b.name = name;
+		v.push_back(b);
+	}
+	fclose(in);
+	return v;
+}
+
+int main(int argc, char** argv) {
+	const char* basePath = NULL;
+	const char* writePath = NULL;
+	double tolerance = 30;
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-'; ++i) {
+		if (i + 1 >= argc)
+			break;
+		if (!strcmp(argv[i], "-k")) {
+			if (!readKnown(argv[++i]))
+				return 2;
+		} else if (!strcmp(argv[i], "-b"))
+			basePath = argv[++i];
+		else if (!strcmp(argv[i], "-w"))
+			writePath = argv[++i];
+		else if (!strcmp(argv[i], "-t"))
+			tolerance = atof(argv[++i]);
+		else
+			break;
+	}
+	if (i >= argc) {
+		fprintf(stderr, "usage: replay [-k known] [-b baseline] [-t percent] [-w baseline] file...\n");
+		return 2;
+	}
+	std::vector<File> files;
+	for (; i < argc; ++i) {
+		File f;
+		if (!load(argv[i], f))
+			return 2;
+		files.push_back(f);
+	}
+
+	File total;
+	total.name = "total";
+	total.pulses = total.expected = total.found = total.extra = total.known = 0;
+	double totalNs = 0;
+	for (size_t k = 0; k < files.size(); ++k)
+		check(files[k]);
+	timeFiles(files, 200);
+	for (size_t k = 0; k < files.size(); ++k) {
+		total.pulses += files[k].pulses;
+		total.expected += files[k].expected;
+		total.found += files[k].found;
+		total.extra += files[k].extra;
+		total.known += files[k].known;
+		totalNs += files[k].ns * files[k].pulses;
+	}
+	total.ns = total.pulses ? totalNs / total.pulses : 0;
+	files.push_back(total);
+
+	std::vector<Baseline> base;
+	if (basePath)
+		base = readBaseline(basePath);
+	bool fail = false;
+	printf("%-14s %7s %8s %6s %6s %6s %9s %9s\n", "file", "pulses", "expected",
+			"found", "extra", "known", "ns/pulse", "baseline");
+	for (size_t k = 0; k < files.size(); ++k) {
+		const File& f = files[k];
+		const Baseline* b = NULL;
+		for (size_t j = 0; j < base.size(); ++j)
+			if (base[j].name == f.name)
+				b = &base[j];
+		std::string verdict;
+		if (f.found + f.known < f.expected)
+			verdict += " missing";
+		if (f.extra > 0)
+			verdict += " extra";
+		if (b && f.name == "total" && f.ns > b->ns * (1 + tolerance / 100))
+			verdict += " ns/pulse";
+		if (!verdict.empty())
+			fail = true;
+		printf("%-14s %7u %8u %6u %6u %6u %9.1f", f.name.c_str(), f.pulses,
+				f.expected, f.found, f.extra, f.known, f.ns);
+		if (b)
+			printf(" %9.1f", b->ns);
+		printf("%s\n", verdict.empty() ? "" : ("  FAIL:" + verdict).c_str());
+	}
+	for (size_t j = 0; j < known.size(); ++j)
+		if (!known[j].seen)
+			printf("known failure gone, drop it from the list: %s %s\n",
+					known[j].where.c_str(), known[j].diff.c_str());
+
+	if (writePath) {
+		FILE* out = fopen(writePath, "w");
+		if (!out) {
+			perror(writePath);
+			return 2;
+		}
+		for (size_t k = 0; k < files.size(); ++k)
+			fprintf(out, "%s %.1f\n", files[k].name.c_str(), files[k].ns);
+		fclose(out);
+	}
+	if (fail)
+		printf("replay: failed, ns/pulse tolerance %.0f%% of %s\n", tolerance,
+				basePath ? basePath : "no baseline");
+	return fail ? 1 : 0;
+}
@@ -0,0 +1,246 @@
+/// @file
+/// Typed readings for the packets reported by the OOK decoders.
+// Each parser takes the bytes of DecodeOOK::getData(), checks the fixed fields
+// and the checksum of its format, and fills a struct owned by the caller. It
+// returns false for anything that does not match, the struct is undefined
+// then. Nothing is allocated and no floating point is used: temperatures are
+// in 0.1 degree Celsius, wind speed in 0.1 m/s and rain in 0.1 mm.
+
+/// Temperature sensor, with humidity if it has one.
+struct ClimateReading {
+  uint16_t type;    // sensor type, 0 if not sent
+  uint8_t channel;  // 1.., 0 if not sent
+  uint8_t id;       // rolling code, changes when the batteries are replaced
+  int16_t temp;     // 0.1 C
+  uint8_t hum;      // %, 0 if not sent
+  bool lowBattery;
+};
+
+/// Weather station with wind and rain gauges.
+struct WeatherReading {
+  uint8_t id;
+  int16_t temp;                // 0.1 C
+  uint8_t hum;                 // %
+  uint16_t windAvg, windGust;  // 0.1 m/s
+  uint16_t rain;               // 0.1 mm, running total
+  uint8_t dir;                 // wind direction in 22.5 degree steps, 0 = N
+};
+
+/// On/off command of a simple remote control switch.
+struct SwitchCommand {
+  uint8_t house;  // house or system code, as set on the switch
+  uint8_t unit;   // 1..
+  bool on;
+};
+
+/// FS20 command, see http://fhz4linux.info/tiki-index.php?page=FS20%20Protocol
+struct FS20Command {
+  uint16_t house;
+  uint8_t addr;
+  uint8_t cmd;    // bit 5 set if ext is valid
+  uint8_t ext;
+};
+
+/// EM 1000 energy monitor counters.
+struct EnergyReading {
+  uint8_t type;   // 1 = EM 1000-S, 2 = EM 1000-EM, 3 = EM 1000-GZ
+  uint8_t addr;
+  uint8_t seq;    // message counter
+  uint16_t total, current, peak;
+};
+
+// two BCD digits, false if either is out of range
+inline bool payloadBcd (uint8_t b, uint8_t& v) {
+  v = (b >> 4) * 10 + (b & 0x0F);
+  return (b >> 4) < 10 && (b & 0x0F) < 10;
+}
+
+inline uint8_t payloadNibbleSum (const uint8_t* d, uint8_t n) {
+  uint8_t s = 0;
+  for (uint8_t i = 0; i < n; ++i)
+    s += (d[i] >> 4) + (d[i] & 0x0F);
+  return s;
+}
+
+/// Oregon Scientific V1 (THN128, ...): 3 BCD digits of temperature and a
+/// checksum that is the sum of the first three bytes, with the carry added.
+inline bool parseOregonV1 (const uint8_t* d, uint8_t n, ClimateReading& r) {
+  if (n < 4)
+    return false;
+  uint16_t sum = d[0] + d[1] + d[2];
+  uint8_t t;
+  if ((uint8_t) (sum + (sum >> 8)) != d[3] || !payloadBcd(d[1], t) || (d[2] & 0x0F) > 9)
+    return false;
+  r.type = 0;
+  r.channel = 0;
+  r.id = d[0];
+  r.temp = (d[2] & 0x0F) * 100 + t;
+  if (d[2] & 0x20)
+    r.temp = -r.temp;
+  r.hum = 0;
+  r.lowBattery = d[2] & 0x80;
+  return true;
+}
+
+/// Oregon Scientific V2.1 and V3 temperature (THN132N, ...) and temperature
+/// and humidity (THGR228N, THGR810, ...) sensors, as reported by
+/// OregonDecoderV2 and V3, with the 0xA sync nibble in the low half of the
+/// first byte. The checksum is the sum of the nibbles before it, less the sync
+/// nibble. Sensors with humidity have it in 2 more nibbles ahead of the
+/// checksum, which tells the two kinds apart.
+inline bool parseOregon (const uint8_t* d, uint8_t n, ClimateReading& r) {
+  if (n < 8 || (d[0] & 0x0F) != 0x0A)
+    return false;
+  uint8_t tens, tenths = d[4] >> 4;
+  if (!payloadBcd(d[5], tens) || tenths > 9)
+    return false;
+  uint8_t sum = payloadNibbleSum(d, 6) + (d[6] & 0x0F) - 0x0A;
+  if (n >= 9 && (uint8_t) (sum + (d[6] >> 4) + payloadNibbleSum(d + 7, 1)) == d[8]) {
+    uint8_t lo = d[6] >> 4, hi = d[7] & 0x0F;
+    if (lo > 9 || hi > 9)
+      return false;
+    r.hum = hi * 10 + lo;
+  } else if (sum == (uint8_t) ((d[6] >> 4) | (d[7] << 4))) {
+    r.hum = 0;
+  } else {
+    return false;
+  }
+  r.type = (d[0] << 8) | d[1];
+  r.channel = d[2] >> 4;
+  if (r.channel == 4)
+    r.channel = 3; // V2.1 sensors send the channel as a bit
+  r.id = d[3];
+  r.temp = tens * 10 + tenths;
+  if (d[6] & 0x08)
+    r.temp = -r.temp;
+  r.lowBattery = d[4] & 0x04;
+  return true;
+}
+
+/// Philips outdoor temperature sensor (AJ3650 and similar): 0001cccc, 10 bits
+/// of temperature in 0.1 C plus 50 C, and a byte with a check nibble that is
+/// not verified here. The channel is sent as a single bit.
+inline bool parsePhilips (const uint8_t* d, uint8_t n, ClimateReading& r) {
+  if (n < 4 || (d[0] >> 4) != 0x1)
+    return false;
+  switch (d[0] & 0x0F) {
+    case 2: r.channel = 1; break;
+    case 4: r.channel = 2; break;
+    case 8: r.channel = 3; break;
+    default: return false;
+  }
+  r.type = 0;
+  r.id = 0;
+  r.temp = (int16_t) ((d[1] << 2) | (d[2] >> 6)) - 500;
+  r.hum = 0;
+  r.lowBattery = false;
+  return true;
+}
+
+/// Fine Offset WH1080 and its clones, as reported by WH1080DecoderV2 after
+/// its CRC check: 0xA, station id, 12 bits of temperature in 0.1 C plus 40 C,
+/// humidity, average and gust wind speed in 0.34 m/s, 12 bits of rain in
+/// 0.3 mm and the wind direction.
+inline bool parseWH1080 (const uint8_t* d, uint8_t n, WeatherReading& r) {
+  if (n < 10 || (d[0] >> 4) != 0x0A || d[3] > 100)
+    return false;
+  r.id = (d[0] << 4) | (d[1] >> 4);
+  r.temp = (int16_t) (((d[1] & 0x0F) << 8) | d[2]) - 400;
+  r.hum = d[3];
+  r.windAvg = d[4] * 34 / 10;
+  r.windGust = d[5] * 34 / 10;
+  r.rain = (((d[6] & 0x0F) << 8) | d[7]) * 3;
+  r.dir = d[8] & 0x0F;
+  return true;
+}
+
+/// KAKU (Klik-Aan-Klik-Uit) PT2262 frame of 12 bits, from KakuDecoder or the
+/// KAKU row of PwmDecoder: house code A..P as 0..15, unit - 1, 3 fixed bits
+/// 0b110 and on/off.
+inline bool parseKaku (const uint8_t* d, uint8_t n, SwitchCommand& r) {
+  if (n < 2 || (d[1] & 0x07) != 0x06)
+    return false;
+  r.house = d[0] & 0x0F;
+  r.unit = (d[0] >> 4) + 1;
+  r.on = d[1] & 0x08;
+  return true;
+}
+
+/// ELRO AB440 and other PT2262 sockets with DIP switches, as the KAKU row of
+/// PwmDecoder reports them (tri-state F = 1): 5 bits of system code, 0 for
+/// each switch that is on, 5 unit bits with only the addressed unit A..E at 0,
+/// then 0F for on or F0 for off.
+inline bool parseElro (const uint8_t* d, uint8_t n, SwitchCommand& r) {
+  if (n < 2)
+    return false;
+  uint16_t v = d[0] | (d[1] << 8);
+  uint8_t units = ~(v >> 5) & 0x1F, state = (v >> 10) & 0x03;
+  if (units == 0 || (units & (units - 1)) || state == 0 || state == 3)
+    return false;
+  r.house = ~v & 0x1F;
+  for (r.unit = 1; !(units & 1); units >>= 1)
+    r.unit++;
+  r.on = state == 2;
+  return true;
+}
+
+/// FS20, as reported by FSxDecoder: the last sync bit, then groups of 8 data
+/// bits and an even parity bit, MSB first. House code (2 bytes), address,
+/// command, an extension byte if bit 5 of the command is set, and a checksum
+/// that is 6 plus the sum of the other bytes.
+inline bool parseFS20 (const uint8_t* d, uint8_t n, FS20Command& r) {
+  uint8_t b[6], count = 5;
+  for (uint8_t i = 0; i < count; ++i) {
+    uint16_t k = 1 + 9 * i;
+    if (k + 9 > 8 * n)
+      return false;
+    uint16_t g = 0;
+    uint8_t parity = 0;
+    for (uint8_t j = 0; j < 9; ++j) {
+      uint8_t bit = (d[(k + j) >> 3] >> (7 - ((k + j) & 7))) & 1;
+      g = (g << 1) | bit;
+      parity ^= bit;
+    }
+    if (parity)
+      return false;
+    b[i] = g >> 1;
+    if (i == 3 && (b[3] & 0x20))
+      count = 6;
+  }
+  uint8_t sum = 6;
+  for (uint8_t i = 0; i < count - 1; ++i)
+    sum += b[i];
+  if (sum != b[count - 1])
+    return false;
+  r.house = (b[0] << 8) | b[1];
+  r.addr = b[2];
+  r.cmd = b[3];
+  r.ext = count == 6 ? b[4] : 0;
+  return true;
+}
+
+/// EM 1000 energy monitors, as reported by EMxDecoder: 10 groups of 8 data
+/// bits LSB first and a 1 stop bit. Type, address, sequence number, three
+/// 16 bit little endian counters and an xor checksum.
+inline bool parseEMx (const uint8_t* d, uint8_t n, EnergyReading& r) {
+  if (n < 12)
+    return false;
+  uint8_t b[10], x = 0;
+  for (uint8_t i = 0; i < 10; ++i) {
+    uint16_t k = 9 * i;
+    uint16_t g = (d[k >> 3] | (d[(k >> 3) + 1] << 8)) >> (k & 7);
+    if (!(g & 0x100))
+      return false;
+    b[i] = g;
+    x ^= b[i];
+  }
+  if (x != 0)
+    return false;
+  r.type = b[0];
+  r.addr = b[1];
+  r.seq = b[2];
+  r.total = b[3] | (b[4] << 8);
+  r.current = b[5] | (b[6] << 8);
+  r.peak = b[7] | (b[8] << 8);
+  return true;
+}
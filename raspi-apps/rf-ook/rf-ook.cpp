@@ -7,6 +7,10 @@
 //
 //============================================================================
 #define STATLOG 1
+#define OOK_STATS 0 //per decoder counters, printed with STATLOG
+#define READINGS 0 //append decoded values to printOOK lines, see payloads.h
+#define TRACELOG 0 //print the pulses before each decoded packet, for replay
+#define CHANNEL_PLAN 0 //hop between the channels of setupDecoders(), see channels.h
 
 #include <stdio.h>
 #include <stdint.h>
@@ -48,35 +52,63 @@ uint32_t samplesSec = 1000000 / tsample;
 
 RF69A<SpiDev0> rfa;
 #include "decodeOOK.h"
+#include "payloads.h"
 //#include "decodeOOK_TEST.h"
 
 const uint8_t max_decoders = 6; //Too many decoders slows processing down.
-DecodeOOK* decoders[max_decoders] = { NULL };
+DecodeOOK* decoderList[max_decoders] = { NULL };
+DecodeOOK** decoders = decoderList; //decoders of the current channel
+PreambleGate gate; //skips parked decoders until their preamble shows up
 uint8_t di = 0;
 void printOOK(class DecodeOOK* decoder); //void relay (class DecodeOOK* decoder);
 
-#if FREQ_BAND == 433
+#if CHANNEL_PLAN
+//433MHz and 868MHz, one channel at a time
+#include "decoders433.h"
+#include "decoders868.h"
+#include "channels.h"
+ChannelPlan<RF69A<SpiDev0> > channels(rfa);
+ElroDecoder       elro(   10, "ELRO ", printOOK);
+WS249 ws249( 20, "WS249", printOOK);
+Philips phi( 21, "PHI  ", printOOK);
+OregonDecoderV1 orscV1( 22, "ORSV1", printOOK);
+PwmDecoder pwm( 30, "PWM  ", printOOK); //KAKU and RcSwitch protocols, see pwmProtocols433
+DecodeOOK* decoders433[] = { &ws249, &phi, &orscV1, &pwm, &elro, NULL };
+WH1080DecoderV2 wh1080(40, "WH1080", printOOK);
+DecodeOOK* decoders868_28[] = { &wh1080, NULL };
+EMxDecoder emx(2, "EMX  ", printOOK);
+FSxDecoder fsx(4, "FS20 ", printOOK);
+DecodeOOK* decoders868_35[] = { &fsx, &emx, NULL };
+void setupDecoders() {
+	//frqkHz, bw, thd, decoders, min/max dwell ms
+	channels.add(433920, 16, fixthd, decoders433, 500, 4000);
+	//channels.add(433700, 17, fixthd, decoders433, 300, 2000); //see rfm69tool sweep
+	channels.add(868280, 17, fixthd, decoders868_28, 300, 3000);
+	channels.add(868350, 17, fixthd, decoders868_35, 300, 3000);
+}
+#elif FREQ_BAND == 433
 //433MHz
 #include "decoders433.h"
 //OregonDecoderV2   orscV2(  5, "ORSV2", printOOK);
 //CrestaDecoder     cres(    6, "CRES ", printOOK);
-KakuDecoder kaku( 7, "KAKU ", printOOK);
+//KakuDecoder kaku( 7, "KAKU ", printOOK);
 //XrfDecoder        xrf(     8, "XRF  ", printOOK);
 //HezDecoder        hez(     9, "HEZ  ", printOOK);
 ElroDecoder       elro(   10, "ELRO ", printOOK);
 //FlamingoDecoder   flam(   11, "FMGO ", printOOK);
 //SmokeDecoder      smok(   12, "SMK  ", printOOK);
-//ByronbellDecoder  byro(   13, "BYR  ", printOOK);
+//Byron SX30T: BYR row of PwmDecoder
 //KakuADecoder      kakuA(  14, "KAKUA", printOOK);
 WS249 ws249( 20, "WS249", printOOK);
 Philips phi( 21, "PHI  ", printOOK);
 OregonDecoderV1 orscV1( 22, "ORSV1", printOOK);
 //OregonDecoderV3   orscV3( 23, "ORSV3", printOOK);
+PwmDecoder pwm( 30, "PWM  ", printOOK); //KAKU and RcSwitch protocols, see pwmProtocols433
 void setupDecoders() {
 	decoders[di++] = &ws249;
 	decoders[di++] = &phi;
 	decoders[di++] = &orscV1;
-	decoders[di++] = &kaku;
+	decoders[di++] = &pwm;
 	decoders[di++] = &elro;
 }
 #else
@@ -101,6 +133,26 @@ void setupDecoders() {
 uint8_t rssi_buf[RSSI_BUF_SIZE];
 uint8_t rssi_buf_i = 0;
 
+#if TRACELOG
+//last pulses, us, negative for low. A decoded packet is printed as
+//TRACE,<tag>,<hex data>,<count>,<pulse>,<pulse>,... oldest pulse first, so the
+//line can be fed back to processBit() and checked against the decoder output.
+//Appended to a file in host/corpus, make check replays it, see host/replay.cpp.
+#define TRACE_SIZE 512 //keep it powers of 2
+int16_t trace_buf[TRACE_SIZE];
+uint16_t trace_i = 0;
+
+void printTrace(class DecodeOOK* decoder, const uint8_t* data, uint8_t pos) {
+	printf("TRACE,%s,", decoder->packetTag());
+	for (uint8_t i = 0; i < pos; ++i)
+		printf("%02x", data[i]);
+	printf(",%d", TRACE_SIZE);
+	for (uint16_t i = 0; i < TRACE_SIZE; ++i)
+		printf(",%d", trace_buf[(trace_i + i) & (TRACE_SIZE - 1)]);
+	printf("\r\n");
+}
+#endif
+
 //uint8_t rssi_b[4096];
 //uint16_t rssi_bi = 0;
 
@@ -116,6 +168,70 @@ void printRSSI() {
 	avgonrssi >> (RSSI_BUF_EXP - 1));
 }
 
+#if READINGS
+void printTemp(int16_t temp) {
+	uint16_t t = temp < 0 ? -temp : temp;
+	printf(" %s%d.%dC", temp < 0 ? "-" : "", t / 10, t % 10);
+}
+
+// append the typed reading of packets with a known layout, see payloads.h
+void printReading(class DecodeOOK* decoder, const uint8_t* data, uint8_t pos) {
+	ClimateReading c;
+	SwitchCommand s;
+	FS20Command f;
+	EnergyReading e;
+	WeatherReading w;
+	bool climate = false, kaku = false;
+	switch (decoder->id) {
+	case 22: //ORSV1
+		climate = parseOregonV1(data, pos, c);
+		break;
+	case 5: //ORSV2
+	case 23: //ORSV3
+		climate = parseOregon(data, pos, c);
+		break;
+	case 21: //PHI
+		climate = parsePhilips(data, pos, c);
+		break;
+#if FREQ_BAND == 433 || CHANNEL_PLAN
+	case 30: //PWM, KAKU row
+		kaku = ((PwmDecoder*) decoder)->getProtocol() == 0; //KAKU row
+		break;
+#endif
+	case 4: //FS20
+		if (parseFS20(data, pos, f))
+			printf(" hc:%04x adr:%02x cmd:%02x", f.house, f.addr, f.cmd);
+		break;
+	case 40: //WH1080
+		if (parseWH1080(data, pos, w)) {
+			printf(" id:%02x", w.id);
+			printTemp(w.temp);
+			printf(" %d%% wind:%d.%d/%d.%dm/s dir:%d rain:%d.%dmm", w.hum,
+			w.windAvg / 10, w.windAvg % 10, w.windGust / 10, w.windGust % 10,
+			w.dir * 45 / 2, w.rain / 10, w.rain % 10);
+		}
+		break;
+	case 2: //EMX
+		if (parseEMx(data, pos, e))
+			printf(" em%d:%d seq:%d total:%d cur:%d peak:%d", e.type, e.addr,
+			e.seq, e.total, e.current, e.peak);
+		break;
+	}
+	if (climate) {
+		printf(" ch:%d id:%02x", c.channel, c.id);
+		printTemp(c.temp);
+		if (c.hum)
+			printf(" %d%%", c.hum);
+		if (c.lowBattery)
+			printf(" bat:low");
+	}
+	if (kaku && parseKaku(data, pos, s))
+		printf(" %c%d:%s", 'A' + s.house, s.unit, s.on ? "on" : "off");
+	else if (kaku && parseElro(data, pos, s))
+		printf(" elro %02x-%c:%s", s.house, 'A' + s.unit - 1, s.on ? "on" : "off");
+}
+#endif
+
 void printOOK(class DecodeOOK* decoder) {
 	uint8_t pos;
 	const uint8_t* data = decoder->getData(pos);
@@ -133,6 +249,9 @@ void printOOK(class DecodeOOK* decoder) {
 		//printf("\r\n%12d ", now);
 	}
 	last_print = now;
+#if CHANNEL_PLAN
+	channels.decoded(now);
+#endif
 
 	//Serial.println("");
 	//Serial.print(hour());
@@ -143,13 +262,19 @@ void printOOK(class DecodeOOK* decoder) {
 	//rf12_settings_text(textbuf);
 	//Serial.print(textbuf);
 	//Serial.print(' ');
-	printf("%s ", decoder->tag);
+	printf("%s ", decoder->packetTag());
 	//Serial.print(' ');
 	for (uint8_t i = 0; i < pos; ++i) {
 		printf("%02x", data[i]);
 	}
 	printRSSI();
+#if READINGS
+	printReading(decoder, data, pos);
+#endif
 	printf("\r\n");
+#if TRACELOG
+	printTrace(decoder, data, pos);
+#endif
 
 	//    uint16_t j = rssi_bi;
 	//    for (uint16_t i = 0; i < 4096; i++) { //not interested in last 300 samples.
@@ -161,6 +286,19 @@ void printOOK(class DecodeOOK* decoder) {
 	decoder->resetDecoder();
 }
 
+#if OOK_STATS
+void printDecoderStats() {
+	printf("decoder  pulses  accept  resets maxbits decodes  dups decode-ns/pulse\r\n");
+	for (uint8_t i = 0; decoders[i]; i++) {
+		const DecodeOOK::Stats& s = decoders[i]->getStats();
+		printf("%s %7d %7d %7d %7d %7d %5d %7d\r\n", decoders[i]->tag, s.pulses,
+		s.pulses - s.resets, s.resets, s.maxBits, s.decodes,
+		decoders[i]->getSuppressed(), s.pulses ? s.cycles / s.pulses : 0);
+		decoders[i]->clearStats();
+	}
+}
+#endif
+
 void processBit(uint16_t pulse_dur, uint8_t signal, uint8_t rssi) {
 	if (rssi) {
 		if (signal) {
@@ -171,8 +309,13 @@ void processBit(uint16_t pulse_dur, uint8_t signal, uint8_t rssi) {
 			rssi_buf[rssi_buf_i + 1] = rssi;
 		}
 	}
+#if TRACELOG
+	int16_t w = pulse_dur > 32767 ? 32767 : pulse_dur;
+	trace_buf[trace_i++ & (TRACE_SIZE - 1)] = signal ? w : -w;
+#endif
+	gate.add(pulse_dur, signal, rssi);
 	for (uint8_t i = 0; decoders[i]; i++) {
-		if (decoders[i]->nextPulse(pulse_dur, signal))
+		if (gate.pass(decoders[i], pulse_dur) && decoders[i]->nextPulse(pulse_dur, signal, rssi))
 		decoders[i]->decoded(decoders[i]);
 	}
 }
@@ -188,9 +331,15 @@ void receiveOOK() {
 	rfa.setBitrate(bitrate);
 	//rfa.setBitrate(3000);
 
+#if CHANNEL_PLAN
+	channels.begin(millis());
+	decoders = channels.decoders();
+	fixthd = channels.current().thd;
+#else
 	rfa.setFrequency(frqkHz);
 	rfa.setBW(bw);
 	rfa.setThd(fixthd);
+#endif
 	rfa.readAllRegs();
 	uint8_t t_step = tsample;
 	uint32_t now = micros();
@@ -274,6 +423,17 @@ void receiveOOK() {
 		rssi_qi = 0;
 
 		uint32_t ts_thdUpdNow = millis();
+#if CHANNEL_PLAN
+		if (channels.poll(ts_thdUpdNow)) {
+			//the noise statistics and threshold are per channel
+			decoders = channels.decoders();
+			fixthd = channels.current().thd;
+			slicethd = fixthd;
+			nrssi = sumrssi = sumsqrssi = 0;
+			last_edge = micros();
+			flush_cnt = 0;
+		}
+#endif
 
 		static uint32_t delay_rssi = 0;
 		delay_rssi++;
@@ -326,8 +486,10 @@ void receiveOOK() {
 		//systime_t ts_printnow = chVTGetSystemTime();
 		if (ts_thdUpdNow - thdUpd >= 10000) {
 			//rssivar = ((sumsqrssi - sumrssi*sumrssi/nrssi) / (nrssi-1)); //64 bits
-			rssivar = ((sumsqrssi - ((sumrssi>>8)*((sumrssi<<8)/nrssi))) / (nrssi-1)); //32bits n<65000
-			uint32_t rssiavg = sumrssi / nrssi;
+			//no variance after a hop without readings, the threshold is kept then
+			rssivar = nrssi < 2 ? 255 :
+			((sumsqrssi - ((sumrssi>>8)*((sumrssi<<8)/nrssi))) / (nrssi-1)); //32bits n<65000
+			uint32_t rssiavg = nrssi ? sumrssi / nrssi : 0;
 			//determine stddev (no sqrt avaialble?)
 			uint8_t stddev = 1;
 			while (stddev < 10) {
@@ -346,7 +508,11 @@ void receiveOOK() {
 				if (fixthd != rssiavg + delta_thd) {
 					fixthd = rssiavg + delta_thd;
 					//if (fixthd < 70) fixthd = 70;
+#if CHANNEL_PLAN
+					channels.setThd(fixthd);
+#else
 					rfa.setThd(fixthd);
+#endif
 					//printf( "THD:%3d\r\n", fixthd);
 				} else {
 					//printf( "THD:keep\r\n");
@@ -362,6 +528,33 @@ void receiveOOK() {
 			printf("%d polls took %d ms = %d us - flips = %d\r\n", thdUpdCnt,
 			(ts_thdUpdNow - thdUpd),
 			1000*(ts_thdUpdNow - thdUpd)/thdUpdCnt, flip_cnt);
+#if CHANNEL_PLAN
+			for (uint8_t i = 0; i < channels.size(); i++) {
+				const ChannelPlan<RF69A<SpiDev0> >::Channel& c = channels.channel(i);
+				printf("CH %d kHz dwell:%d score:%d thd:%d hops:%d decodes:%d\r\n",
+				c.frqkHz, c.dwell, c.score, c.thd, c.hops, c.decodes);
+			}
+			printf("hop: %d regs in %d us\r\n", channels.hopRegs, channels.hopUs);
+			channels.clearStats();
+#endif
+			for (uint8_t i = 0; decoders[i]; i++)
+			printf("%s dups:%d fixed:%d ", decoders[i]->tag, decoders[i]->getSuppressed(),
+			decoders[i]->getRepaired());
+			printf("\r\n");
+			for (uint8_t i = 0; decoders[i]; i++) {
+				const TimingCal* t = decoders[i]->getTiming();
+				if (!t)
+					continue;
+				printf("%s split:%d", decoders[i]->tag, t->getSplit());
+				for (uint8_t j = 0; j < t->getCount(); j++) {
+					const TimingCal::Sensor& e = t->getSensor(j);
+					printf(" id%d:%d/%d(%d)", e.id, e.shortWidth, e.longWidth, e.packets);
+				}
+				printf("\r\n");
+			}
+#if OOK_STATS
+			printDecoderStats();
+#endif
 #endif
 
 			nrssi = sumrssi = sumsqrssi = rssimax = max_thd = 0;
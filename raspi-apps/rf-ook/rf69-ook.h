@@ -5,6 +5,21 @@
 #define STATLOG 0
 #endif
 
+// configuration registers kept in a context, the others hold status. LNA
+// (0x18) reads back the current gain and is set once by init(), AFCFEI (0x1E)
+// holds the AFC/FEI start and clear triggers, see clearAFC().
+static const uint8_t contextRegs[] = {
+  0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, // modulation, freq
+  0x0B,                                           // afc ctrl
+  0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,       // pa, ocp
+  0x19, 0x1A, 0x1B, 0x1C, 0x1D,                   // rxbw, ook thd
+  0x25, 0x26,                                     // dio, clkout
+  0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E,             // rssi, preamble
+  0x2F, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, // sync value
+  0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D,       // packet, fifo
+  0x58, 0x5A, 0x5C, 0x6F, 0x71,                   // test regs
+};
+
 template< typename SPI >
 class RF69A : public RF69<SPI> {
   public:
@@ -21,6 +36,11 @@ class RF69A : public RF69<SPI> {
     void DataModule(uint8_t module);
     void OOKthdMode(uint8_t thdmode);
     void exit_receive();
+    void enter_receive();
+    void clearAFC();
+    enum { CONTEXT_SIZE = sizeof contextRegs };
+    void saveContext(uint8_t* ctx);
+    uint8_t switchContext(const uint8_t* from, const uint8_t* to);
     //void receiveOOK_forever(ooktrans_cb processBit);
     void sendook(uint8_t header, const void* ptr, int len);
     void init_transmit(uint8_t band);
@@ -223,6 +243,42 @@ void RF69A<SPI>::exit_receive() {
   this->writeReg(REG_RSSITHRESH, 0xE4); // RssiThresh 0xE4
 }
 
+// receive again after switchContext()
+template< typename SPI >
+void RF69A<SPI>::enter_receive() {
+  setMode(MODE_RECEIVE);
+}
+
+// drop the AFC correction of the previous channel. Essential for wideband OOK
+// signals, no other way to reset from SW.
+template< typename SPI >
+void RF69A<SPI>::clearAFC() {
+  this->writeReg(REG_AFCFEI, (1 << 1));
+}
+
+template< typename SPI >
+void RF69A<SPI>::saveContext(uint8_t* ctx) {
+  for (uint8_t i = 0; i < CONTEXT_SIZE; ++i)
+    ctx[i] = this->readReg(contextRegs[i]);
+}
+
+// go to standby and write the registers that differ between two saved
+// contexts, returns the number written. Standby keeps the crystal running,
+// so receive restarts as soon as the PLL has locked.
+template< typename SPI >
+uint8_t RF69A<SPI>::switchContext(const uint8_t* from, const uint8_t* to) {
+  uint8_t n = 0;
+
+  setMode(MODE_STANDBY);
+  for (uint8_t i = 0; i < CONTEXT_SIZE; ++i) {
+    if (from[i] != to[i]) {
+      this->writeReg(contextRegs[i], to[i]);
+      ++n;
+    }
+  }
+  return n;
+}
+
 //template< typename SPI >
 //void RF69A<SPI>::receiveOOK_forever(ooktrans_cb processBit) {
 //  //moving average buffer
@@ -11,6 +11,8 @@ public:
     void setThd(uint8_t thd);
     void setBW(uint8_t bw);
     void setFrequency(uint32_t frq);
+    void setFrf(uint32_t frf);
+    bool pllLocked();
     void setBitrate(uint32_t br);
 
     //test functions
@@ -21,6 +23,8 @@ public:
     uint8_t myGroup;
 
 protected:
+    uint32_t frfNow; // last FRF written, ~0 if unknown
+
     enum {
         REG_FIFO          = 0x00,
         REG_OPMODE        = 0x01,
@@ -55,6 +59,7 @@ protected:
 
         IRQ1_MODEREADY    = 1<<7,
         IRQ1_RXREADY      = 1<<6,
+        IRQ1_PLLLOCK      = 1<<4,
 
         IRQ2_FIFOFULL     = 1<<7,
         IRQ2_FIFONOTEMPTY = 1<<6,
@@ -102,6 +107,7 @@ void RF69A<SPI>::init (uint8_t id, uint8_t group, int freq) {
     this->writeReg(REG_AFCFEI, (1<<1));
     //this->writeReg(REG_AFCFEI, this->readReg(REG_AFCFEI) | (1 << 1)); //does not work
     myGroup = group;
+    frfNow = ~0;
     this->setMode(MODE_RECEIVE);
 }
 
@@ -196,6 +202,30 @@ void RF69A<SPI>::setFrequency (uint32_t frq) {
     this->writeReg(REG_FRFMSB, frf >> 16);
     this->writeReg(REG_FRFMSB+1, frf >> 8);
     this->writeReg(REG_FRFMSB+2, frf);
+    frfNow = frf;
+}
+
+// hop to a frequency in FRF steps of 61 Hz, without the AFC clear of
+// setFrequency(). The radio only retunes when FrfLsb is written, so that is
+// always written, the higher bytes only when they change, in one burst.
+template< typename SPI >
+void RF69A<SPI>::setFrf (uint32_t frf) {
+    uint8_t reg = REG_FRFMSB + 2;
+    if ((frf ^ frfNow) & 0xFF0000)
+        reg = REG_FRFMSB;
+    else if ((frf ^ frfNow) & 0x00FF00)
+        reg = REG_FRFMSB + 1;
+    this->spi.enable();
+    this->spi.transfer(reg | 0x80);
+    for (; reg <= REG_FRFMSB + 2; ++reg)
+        this->spi.transfer(frf >> (8 * (REG_FRFMSB + 2 - reg)));
+    this->spi.disable();
+    frfNow = frf;
+}
+
+template< typename SPI >
+bool RF69A<SPI>::pllLocked () {
+    return this->readReg(REG_IRQFLAGS1) & IRQ1_PLLLOCK;
 }
 
 template< typename SPI >
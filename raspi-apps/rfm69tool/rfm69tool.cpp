@@ -25,6 +25,7 @@ static volatile int maxdur = 0;
 static volatile bool data_on = false;
 
 #include "radio-ook.h"
+#include "sweep.h"
 
 RF69A<SpiDevice> rf;
 
@@ -360,12 +361,8 @@ void printRSSIBuffer(bool details, uint16_t tsample) {
 //  }
 //}
 
+// sweep forever, writing one binary frame per sweep to stdout, see sweep.h
 void sweep() {
-    const uint16_t tsample = 50;
-    rtcnt_t t_step = US2RTC(STM32_SYSCLK, tsample);
-    rtcnt_t now = chSysGetRealtimeCounterX();
-    rtcnt_t soon = now + t_step;
-
     rf.DataModule(0x60); //setup FSK
     //frqkHz = 433920;
     frqkHz = 868400;
@@ -379,30 +376,16 @@ void sweep() {
     rf.setFrequency(frqkHz);
     rf.setBW(bw);
     rf.setBitrate(bitrate);
-    rf.readAllRegs();
-    while(1) { //scan forever
-        //for (frqkHz = 433400; frqkHz < 434200; frqkHz += 10) {
-        //for (frqkHz = 867800; frqkHz < 869000; frqkHz += 10) {
-        for (frqkHz = 868200; frqkHz < 868450; frqkHz += 3) {
-            rf.setFrequency(frqkHz);
-            //wait to settle PLL.
-            chSysPolledDelayX(t_step);
-            uint8_t rssi = ~rf.readRSSI();
-            chprintf(serial, "%d,", rssi);
-
-//            //sleep at resolutions higher then system tick
-//            now = chSysGetRealtimeCounterX();
-//            rtcnt_t sleep = soon - now;
-//            if (sleep<t_step && sleep > 0) {
-//                chSysPolledDelayX(sleep);
-//            }
-//            soon += t_step;
 
-        }
-        chprintf(serial, "\r\n");
+    //static RssiSweep<RF69A<SpiDevice> > sw(rf, 433400000, 10000, 80, 4);
+    //static RssiSweep<RF69A<SpiDevice> > sw(rf, 867800000, 10000, 120, 4);
+    static RssiSweep<RF69A<SpiDevice> > sw(rf, 868200000, 3000, 84, 4);
+    fprintf(stderr, "settle %d us after a hop\n", sw.calibrate());
+    while(1) { //scan forever
+        sw.run();
+        sw.write(stdout);
     }
 
-
     rf.DataModule(0x68); //setup OOK
 }
 
@@ -588,7 +571,7 @@ int main () {
     return 1;
   }
 
-  printf("\n[rfm69tool]\n");
+  fprintf(stderr, "\n[rfm69tool]\n"); //stdout carries the sweep frames
 
   rf.init(1, 42, 433920);
   //rf.encrypt("mysecret");
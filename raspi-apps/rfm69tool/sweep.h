@@ -0,0 +1,113 @@
+/// @file
+/// Fast RSSI sweep over a range of frequencies, for a live waterfall.
+// Each bin is a hop with RF69A::setFrf(), which usually only writes FrfLsb, a
+// wait for the PLL to settle, and a number of RSSI readings that give the
+// minimum, average and maximum level of the bin. The settle time is measured
+// once by calibrate(): the time until the PLL reports lock after the largest
+// hop of the sweep, from the last bin back to the first, plus a margin.
+// Each sweep is written as one binary frame, all fields little endian:
+//   'S' 'W'            magic
+//   uint8_t seq        sweep counter
+//   uint8_t samples    RSSI readings per bin
+//   uint16_t bins
+//   uint32_t startHz, stepHz
+//   uint32_t us        duration of the sweep
+//   min, avg, max      per bin, as ~RssiValue: higher is stronger, 0.5 dB steps
+
+#ifndef SWEEP_MAXBINS
+#define SWEEP_MAXBINS 1024
+#endif
+#ifndef SWEEP_MIN_SETTLE
+#define SWEEP_MIN_SETTLE 20  // us, PLL hop time of small steps
+#endif
+
+template< typename RADIO >
+class RssiSweep {
+  public:
+    uint16_t settle;  // us to wait after a hop
+
+    RssiSweep (RADIO& radio, uint32_t startHz, uint32_t stepHz, uint16_t bins,
+               uint8_t samples)
+      : settle (SWEEP_MIN_SETTLE), rf (radio), start (startHz), step (stepHz),
+        count (bins < SWEEP_MAXBINS ? bins : SWEEP_MAXBINS),
+        reads (samples > 0 ? samples : 1), seq (0), us (0) {}
+
+    // measure the time to PLL lock after the hop to the first bin, a few
+    // times, and keep the worst with 25% margin
+    uint16_t calibrate () {
+      uint32_t worst = 0;
+      for (uint8_t i = 0; i < 8; ++i) {
+        rf.setFrf(frf(count - 1));
+        delayMicroseconds(1000);
+        uint32_t t = micros();
+        rf.setFrf(frf(0));
+        while (!rf.pllLocked() && micros() - t < 2000)
+          ;
+        t = micros() - t;
+        if (t > worst)
+          worst = t;
+      }
+      worst += worst / 4;
+      settle = worst > SWEEP_MIN_SETTLE ? worst : SWEEP_MIN_SETTLE;
+      return settle;
+    }
+
+    // one sweep, returns its duration in us
+    uint32_t run () {
+      uint32_t t = micros();
+      for (uint16_t i = 0; i < count; ++i) {
+        rf.setFrf(frf(i));
+        delayMicroseconds(settle);
+        uint8_t lo = 255, hi = 0;
+        uint16_t sum = 0;
+        for (uint8_t k = 0; k < reads; ++k) {
+          uint8_t v = ~rf.readRSSI();
+          sum += v;
+          if (v < lo)
+            lo = v;
+          if (v > hi)
+            hi = v;
+        }
+        uint8_t* b = level + 3 * i;
+        b[0] = lo;
+        b[1] = (sum + reads / 2) / reads;
+        b[2] = hi;
+      }
+      us = micros() - t;
+      ++seq;
+      return us;
+    }
+
+    // write the last sweep as a frame
+    void write (FILE* f) {
+      uint8_t head[18] = { 'S', 'W', seq, reads };
+      put(head + 4, count, 2);
+      put(head + 6, start, 4);
+      put(head + 10, step, 4);
+      put(head + 14, us, 4);
+      fwrite(head, 1, sizeof head, f);
+      fwrite(level, 3, count, f);
+      fflush(f);
+    }
+
+  private:
+    RADIO& rf;
+    uint32_t start, step;
+    uint16_t count;
+    uint8_t reads, seq;
+    uint32_t us;
+    uint8_t level[3 * SWEEP_MAXBINS];  // min, avg, max per bin
+
+    // FRF of bin i, in steps of 32 MHz / 2^19
+    uint32_t frf (uint16_t i) const {
+      uint64_t hz = start + (uint64_t) step * i;
+      return ((hz << 19) + 16000000) / 32000000;
+    }
+
+    static void put (uint8_t* p, uint32_t v, uint8_t n) {
+      while (n-- > 0) {
+        *p++ = v;
+        v >>= 8;
+      }
+    }
+};